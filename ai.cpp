@@ -1,140 +1,1418 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
 #include <cstdlib>
+#include <ctime>
+#include <fstream>
+#include <functional>
 #include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
 
 #include "ai.h"
-#include "view.h"
-#include "controller.h"
+#include "book.h"
+#include "cache.h"
+#include "endgame.h"
+#include "eval.h"
+#include "mcts.h"
+#include "nnue.h"
+#include "ordering.h"
+#include "probcut.h"
+#include "transposition.h"
 
-static int counter = 0;
+// Cota de los valores posibles (diferencia de fichas)
+#define SCORE_INFINITY (BOARD_SIZE * BOARD_SIZE + 1)
 
-void populateTree(Tree* father, Moves fatherValidMoves, int iterator)
+// Profundidad mnima para ordenar por movilidad (cerca de las hojas no compensa)
+#define ORDER_MOBILITY_DEPTH 3
+
+// Cada cuntos nodos se consulta el reloj
+#define TIME_CHECK_NODES 1024
+
+// Uno de cada cuntos nodos mide el tiempo de sus etapas (generacin de
+// jugadas y evaluacin); medir todos costara ms que las etapas mismas
+#define PROFILE_SAMPLE_NODES 64
+
+// Profundidad de la bsqueda de respaldo antes de resolver el final exacto
+#define ENDGAME_FALLBACK_DEPTH 6
+
+// Profundidad mnima de los nodos que consultan y guardan el cach
+// persistente. Las iteraciones ya guardadas terminan en el acto, as que la
+// siguiente slo encuentra jugadas para ordenar en el cach: con un mnimo
+// ms alto, los nodos cerca de las hojas quedan sin ordenar y la bsqueda
+// tibia resulta ms lenta que una nueva
+#define CACHE_MIN_DEPTH 2
+
+typedef std::chrono::steady_clock Clock;
+
+// Estado propio de cada hilo de bsqueda
+struct SearchThread
 {
-    // Crea el enesimo nodo hijo
-    father->sons.push_back(new Tree());
-    Tree* thisNode = father->sons[iterator];
-    thisNode->move = fatherValidMoves[iterator];
+    AIEngine *engine;
+    int id;
+    uint64_t counter;
 
-    // Juega el movimiento vlido en la simulacin
-    thisNode->sim = father->sim;
-    playMove(thisNode->sim, thisNode->move);
+    HistoryTable history;
+    OrderingStats orderingStats;
+    TTStats tableStats;
 
-    // Busca todos los valid moves
-    Moves thisNodeValidMoves;
-    getValidMoves(thisNode->sim, thisNodeValidMoves);
-    Player aiPlayer =
-                (thisNode->sim.humanPlayer == PLAYER_WHITE)
-                ? PLAYER_BLACK
-                : PLAYER_WHITE;
-    
-    // Es un nodo hoja, o el mximo de nodos?
-    if (thisNodeValidMoves.size() == 0 || counter == COTA_NIVELES)
-    {
-       thisNode->value = getScore(thisNode->sim, aiPlayer) - getScore(thisNode->sim, thisNode->sim.humanPlayer);
-       
-    }
+    // Distancia a la raz del nodo actual y la mayor alcanzada
+    int ply;
+    int selectiveDepth;
+    uint64_t probCutCuts;
+
+    // Tiempo de las etapas en los nodos medidos
+    double moveGenSeconds;
+    double evalSeconds;
+
+    // ndices de los patrones, o acumuladores de la red, de la posicin que
+    // se est buscando (slo los de la evaluacin elegida)
+    EvalState eval;
+    NnueAccumulator accumulator;
+};
+
+// Bsqueda en segundo plano: una jugada de la IA o el anlisis durante el
+// turno del humano
+enum WorkerTask
+{
+    TASK_SEARCH,
+    TASK_PONDER,
+};
+
+// Resultado del anlisis de una respuesta del humano
+struct PonderResult
+{
+    GameModel model;
+    Moves rootMoves;
+    Square move;
+    int score;
+    int depth;
+    int emptySquares;
+    double seconds;
+};
+
+// Estado de un motor: cada motor tiene su propia tabla, hilos y reloj, as
+// que varios motores pueden buscar a la vez en el mismo proceso
+struct AIEngine
+{
+    EvalWeights weights;
+    NnueWeights network;
+    EvalMode evalMode;
+    OpeningBook book;
+    PositionCache cache;
+    // Archivo de la cach abierta, para volver a abrirla si cambia la evaluacin
+    std::string cachePath;
+    size_t cacheSize;
+    uint64_t cacheFingerprint;
+    SearchMode searchMode;
+    ProbCutParams probCut;
+    int selectivity;
+
+    TranspositionTable table;
+    MctsSearch mcts;
+    size_t tableSize;
+    TTStats tableStats;
+    OrderingStats orderingStats;
+
+    std::vector<SearchThread> threads;
+    int endgameEmpties;
+    SearchStats searchStats;
+    double endgameSeconds;
+    std::ofstream searchLog;
+
+    // Lmites de getBestMove (0 es sin lmite) y progreso de sus bsquedas
+    int maxDepth;
+    uint64_t maxNodes;
+    SearchInfoCallback infoCallback;
+    void *infoContext;
+
+    Clock::time_point searchStart;
+    double searchBudget;
+    uint64_t searchNodeBudget;
+    // Nodos de todos los hilos, sumados de a TIME_CHECK_NODES, ms los del
+    // final exacto en curso
+    std::atomic<uint64_t> searchNodes;
+    const EndgameSearch *endgameSearch;
+    std::atomic<bool> searchAborted;
+    std::atomic<bool> searchCancelled;
+
+    std::thread worker;
+    WorkerTask workerTask;
+    std::atomic<bool> workerDone;
+    Square workerMove;
+
+    bool ponderingEnabled;
+    std::vector<PonderResult> ponderResults;
+};
+
+static double getElapsedTime(AIEngine &engine)
+{
+    return std::chrono::duration<double>(Clock::now() - engine.searchStart).count();
+}
+
+static inline double getSeconds(Clock::time_point start)
+{
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+// Costo de leer el reloj, que se descuenta de las etapas medidas (duran
+// apenas unas decenas de nanosegundos)
+static double getClockOverhead()
+{
+    static const double overhead = []() {
+        const int samples = 1000;
+        Clock::time_point start = Clock::now();
+        for (int i = 0; i < samples; i++)
+            Clock::now();
+
+        return getSeconds(start) / samples;
+    }();
+
+    return overhead;
+}
+
+static inline double getStageSeconds(Clock::time_point start)
+{
+    return std::max(getSeconds(start) - getClockOverhead(), 0.0);
+}
+
+// Consulta el reloj: corta la bsqueda si se agot el tiempo o los nodos,
+// o fue cancelada
+static void checkSearchTime(AIEngine &engine, uint64_t nodes)
+{
+    if ((getElapsedTime(engine) >= engine.searchBudget) ||
+        (engine.searchNodeBudget && (nodes >= engine.searchNodeBudget)) ||
+        engine.searchCancelled)
+        engine.searchAborted = true;
+}
+
+static bool isEndgameAborted(void *context)
+{
+    AIEngine &engine = *(AIEngine *)context;
+
+    checkSearchTime(engine, engine.searchNodes + engine.endgameSearch->nodes);
+
+    return engine.searchAborted;
+}
+
+static int getEmptySquares(GameModel &model)
+{
+    return BOARD_SIZE * BOARD_SIZE -
+           countBits(model.board[PLAYER_BLACK] | model.board[PLAYER_WHITE]);
+}
+
+// Lleva una jugada al principio de la lista, conservando el orden del resto
+static void moveToFront(Moves &moves, Square move)
+{
+    for (size_t i = 0; i < moves.size(); i++)
+        if ((moves[i].x == move.x) && (moves[i].y == move.y))
+            std::rotate(moves.begin(), moves.begin() + i, moves.begin() + i + 1);
+}
+
+// Valor final: diferencia entre las fichas del jugador que mueve y las del oponente
+static int evaluateFinal(GameModel &node)
+{
+    Player player = node.currentPlayer;
+    Player opponent = (player == PLAYER_WHITE) ? PLAYER_BLACK : PLAYER_WHITE;
+
+    return getScore(node, player) - getScore(node, opponent);
+}
+
+// Prepara la evaluacin elegida para buscar desde una posicin
+static void initSearchEval(SearchThread &thread, GameModel &node)
+{
+    AIEngine &engine = *thread.engine;
+
+    if (engine.evalMode == EVAL_NETWORK)
+        initNnueAccumulator(thread.accumulator, engine.network, node);
+    else
+        initEvalState(thread.eval, node);
+}
+
+// Hace una jugada de la bsqueda, actualizando los ndices de los patrones
+// o los acumuladores de la red
+static inline uint64_t makeSearchMove(SearchThread &thread, GameModel &node, int index)
+{
+    AIEngine &engine = *thread.engine;
+    Player player = node.currentPlayer;
+    uint64_t flips = makeMove(node, index);
+
+    if (engine.evalMode == EVAL_NETWORK)
+        updateNnueAccumulator(thread.accumulator, engine.network, player, index, flips);
+    else
+        updateEvalState(thread.eval, player, index, flips);
+    thread.ply++;
+
+    return flips;
+}
+
+static inline void unmakeSearchMove(SearchThread &thread, GameModel &node, int index, uint64_t flips)
+{
+    AIEngine &engine = *thread.engine;
+    unmakeMove(node, index, flips);
+
+    if (engine.evalMode == EVAL_NETWORK)
+        restoreNnueAccumulator(thread.accumulator, engine.network, node.currentPlayer, index, flips);
     else
+        restoreEvalState(thread.eval, node.currentPlayer, index, flips);
+    thread.ply--;
+}
+
+static int functionNegamax(SearchThread &thread, GameModel &node, int depth, int alpha, int beta);
+
+// Multi-ProbCut: si bsquedas cortas muestran con suficiente confianza que
+// la bsqueda completa quedara fuera de la ventana, se corta sin hacerla.
+// Devuelve true con el valor del corte (alfa o beta)
+static bool tryProbCut(SearchThread &thread, GameModel &node, int depth, int alpha, int beta, int &value)
+{
+    AIEngine &engine = *thread.engine;
+    float threshold = getProbCutThreshold(engine.selectivity);
+    int phase = getEvalPhase(node);
+
+    for (int check = 0; check < PROBCUT_CHECKS; check++)
     {
-        counter++;
-        for (int i = 0; i < thisNodeValidMoves.size(); i++)
-            populateTree(thisNode, thisNodeValidMoves, i);
+        int shallowDepth = getProbCutDepth(depth, check);
+        if (shallowDepth < 0)
+            break;
+
+        const ProbCutRegression &regression = engine.probCut.regressions[phase][depth][check];
+        if ((regression.sigma <= 0) || (regression.slope <= 0))
+            continue;
+        float margin = threshold * regression.sigma;
+
+        // Cota superior: el valor profundo supera beta si el corto supera shallowBeta
+        int shallowBeta = (int)std::ceil((beta + margin - regression.intercept) / regression.slope);
+        if (shallowBeta <= BOARD_SIZE * BOARD_SIZE)
+        {
+            shallowBeta = std::max(shallowBeta, -BOARD_SIZE * BOARD_SIZE);
+
+            int shallowValue = functionNegamax(thread, node, shallowDepth, shallowBeta - 1, shallowBeta);
+            if (engine.searchAborted || (shallowValue >= shallowBeta))
+            {
+                thread.probCutCuts++;
+                value = beta;
+                return true;
+            }
+        }
+
+        // Cota inferior: el valor profundo no llega a alfa
+        int shallowAlpha = (int)std::floor((alpha - margin - regression.intercept) / regression.slope);
+        if (shallowAlpha >= -BOARD_SIZE * BOARD_SIZE)
+        {
+            shallowAlpha = std::min(shallowAlpha, BOARD_SIZE * BOARD_SIZE);
+
+            int shallowValue = functionNegamax(thread, node, shallowDepth, shallowAlpha, shallowAlpha + 1);
+            if (engine.searchAborted || (shallowValue <= shallowAlpha))
+            {
+                thread.probCutCuts++;
+                value = alpha;
+                return true;
+            }
+        }
     }
+
+    return false;
 }
 
-int functionMinMax(Tree * father) 
+// Negamax con poda alfa-beta: recorre el rbol en profundidad sin guardarlo,
+// haciendo y deshaciendo cada jugada sobre el mismo modelo
+static int functionNegamax(SearchThread &thread, GameModel &node, int depth, int alpha, int beta)
 {
-    Player aiPlayer =
-        (father->sim.humanPlayer == PLAYER_WHITE)
-        ? PLAYER_BLACK
-        : PLAYER_WHITE;
-    
-    // Es un nodo hoja?
-    if (father->sons.size() == 0)
+    AIEngine &engine = *thread.engine;
+
+    if ((++thread.counter % TIME_CHECK_NODES) == 0)
+        checkSearchTime(engine, engine.searchNodes += TIME_CHECK_NODES);
+
+    if (thread.ply > thread.selectiveDepth)
+        thread.selectiveDepth = thread.ply;
+
+    bool profiled = (thread.counter % PROFILE_SAMPLE_NODES) == 0;
+    Clock::time_point stageStart;
+    if (profiled)
+        stageStart = Clock::now();
+
+    // Es la profundidad mxima? Se estima el resultado con los patrones o la
+    // red, salvo con el tablero lleno, donde el resultado es exacto
+    if (depth == 0)
     {
-        return father->value;
+        if (!getEmptySquares(node))
+            return evaluateFinal(node);
+
+        int value = (engine.evalMode == EVAL_NETWORK)
+                        ? evaluateNnue(engine.network, thread.accumulator, node)
+                        : evaluatePosition(engine.weights, thread.eval, node);
+        if (profiled)
+            thread.evalSeconds += getStageSeconds(stageStart);
+
+        return value;
     }
-    else
+
+    // Sin jugadas: pasa (sin gastar profundidad), o es un nodo hoja si el
+    // oponente tampoco puede jugar
+    uint64_t moves = getValidMovesBitboard(node);
+    if (profiled)
+        thread.moveGenSeconds += getStageSeconds(stageStart);
+    if (!moves)
+    {
+        Player opponent = (node.currentPlayer == PLAYER_WHITE) ? PLAYER_BLACK : PLAYER_WHITE;
+        if (!getMovesBitboard(node.board[opponent], node.board[node.currentPlayer]))
+            return evaluateFinal(node);
+
+        makePass(node);
+        thread.ply++;
+        int value = -functionNegamax(thread, node, depth, -beta, -alpha);
+        thread.ply--;
+        makePass(node);
+
+        return value;
+    }
+
+    // La posicin ya fue analizada por otro orden de jugadas?
+    int alphaOrig = alpha;
+    int ttMove = TT_NO_MOVE;
+    TTEntry entry;
+    bool found = probeTranspositionTable(engine.table, node.hash, entry, thread.tableStats);
+    if (found)
+    {
+        ttMove = entry.bestMove;
+
+        if (entry.depth >= depth)
+        {
+            if ((entry.bound == BOUND_EXACT) ||
+                ((entry.bound == BOUND_LOWER) && (entry.score >= beta)) ||
+                ((entry.bound == BOUND_UPPER) && (entry.score <= alpha)))
+                return entry.score;
+        }
+    }
+
+    // O en una sesin anterior? Slo si la tabla no alcanza
+    bool cached = engine.cache.buckets && (depth >= CACHE_MIN_DEPTH);
+    if (cached && (!found || (entry.depth < depth)) &&
+        probePositionCache(engine.cache, node, entry))
     {
-        int result = 0;
-        int minMaxVal = (father->sim.currentPlayer == aiPlayer) ? -64 : 64; 
-        for (auto i = 0; father->sons.size() > i; i++)
+        if (ttMove == TT_NO_MOVE)
+            ttMove = entry.bestMove;
+
+        if (entry.depth >= depth)
         {
-            int childValue = functionMinMax(father->sons[i]);
+            if ((entry.bound == BOUND_EXACT) ||
+                ((entry.bound == BOUND_LOWER) && (entry.score >= beta)) ||
+                ((entry.bound == BOUND_UPPER) && (entry.score <= alpha)))
+                return entry.score;
+        }
+    }
 
-            // Max
-            if (father->sim.currentPlayer == aiPlayer)
-            {
-                if(minMaxVal < childValue)
-                    minMaxVal = childValue;
-            }
-            else
+    // Sin ProbCut si la bsqueda llega al final del juego: as una bsqueda
+    // con profundidad hasta el final es exacta, y sus valores en la tabla y
+    // en la cach tambin
+    int probCutValue;
+    if (engine.selectivity && (depth < getEmptySquares(node)) &&
+        tryProbCut(thread, node, depth, alpha, beta, probCutValue))
+        return probCutValue;
+
+    // Ordena las jugadas: la mejor jugada guardada primero, despus las
+    // prioridades estticas, la movilidad del oponente y la historia
+    if (profiled)
+        stageStart = Clock::now();
+    MoveList list;
+    orderMoves(list,
+               node,
+               moves,
+               ttMove,
+               thread.history,
+               depth >= ORDER_MOBILITY_DEPTH);
+    if (profiled)
+        thread.moveGenSeconds += getStageSeconds(stageStart);
+
+    int bestValue = -SCORE_INFINITY;
+    int bestMove = TT_NO_MOVE;
+    for (int i = 0; i < list.count; i++)
+    {
+        int index = selectNextMove(list, i);
+
+        uint64_t flips = makeSearchMove(thread, node, index);
+        int value = -functionNegamax(thread, node, depth - 1, -beta, -alpha);
+        unmakeSearchMove(thread, node, index, flips);
+
+        // Si se agot el tiempo, el valor no sirve: se descarta toda la iteracin
+        if (engine.searchAborted)
+            return 0;
+
+        if (value > bestValue)
+        {
+            bestValue = value;
+            bestMove = index;
+            if (value > alpha)
+                alpha = value;
+
+            // Poda: el oponente nunca elegira esta rama
+            if (alpha >= beta)
             {
-                if(minMaxVal > childValue)
-                    minMaxVal = childValue;
+                updateHistory(thread.history,
+                              thread.orderingStats,
+                              node.currentPlayer,
+                              index,
+                              i,
+                              depth);
+                break;
             }
         }
-        return minMaxVal;
     }
+
+    Bound bound = (bestValue <= alphaOrig)
+                      ? BOUND_UPPER
+                      : (bestValue >= beta) ? BOUND_LOWER : BOUND_EXACT;
+    storeTranspositionTable(engine.table, node.hash, depth, bound, bestValue, bestMove);
+    if (cached)
+        storePositionCache(engine.cache, node, depth, bound, bestValue, bestMove);
+
+    return bestValue;
+}
+
+// Busca la raz a una profundidad fija; devuelve false si se agot el tiempo
+static bool searchRoot(SearchThread &thread,
+                       GameModel &model,
+                       Moves &rootMoves,
+                       int depth,
+                       Square &bestMove,
+                       int &bestScore)
+{
+    int alpha = -SCORE_INFINITY;
+
+    initSearchEval(thread, model);
+    thread.ply = 0;
+
+    // Slo una jugada estrictamente mejor reemplaza a la anterior, igual que
+    // en el minimax sin poda
+    for (auto move : rootMoves)
+    {
+        int index = getSquareIndex(move);
+        uint64_t flips = makeSearchMove(thread, model, index);
+        int value = -functionNegamax(thread, model, depth - 1, -SCORE_INFINITY, -alpha);
+        unmakeSearchMove(thread, model, index, flips);
+        if (thread.engine->searchAborted)
+            return false;
+
+        if (value > alpha)
+        {
+            alpha = value;
+            bestMove = move;
+        }
+    }
+
+    bestScore = alpha;
+
+    // La raz no pasa por la bsqueda: se guarda aparte, as una bsqueda
+    // posterior de la misma posicin arranca desde esta profundidad
+    storeTranspositionTable(thread.engine->table,
+                            model.hash,
+                            depth,
+                            BOUND_EXACT,
+                            alpha,
+                            getSquareIndex(bestMove));
+
+    return true;
+}
+
+// Hilo auxiliar de Lazy SMP: repite la profundizacin iterativa del hilo
+// principal sobre la tabla compartida, sin devolver resultados. Los hilos
+// impares arrancan un nivel ms profundo, as los hilos se desfasan y
+// completan la tabla con posiciones que el principal todava no visit
+static void helperSearch(SearchThread &thread, GameModel model, Moves rootMoves, int emptySquares)
+{
+    for (int depth = 1 + (thread.id % 2); depth <= MAX_SEARCH_DEPTH; depth++)
+    {
+        Square iterationMove = rootMoves[0];
+        int iterationScore;
+        if (!searchRoot(thread, model, rootMoves, depth, iterationMove, iterationScore) ||
+            (depth >= emptySquares))
+            break;
+
+        // Cada hilo recorre la raz en un orden distinto
+        std::rotate(rootMoves.begin(), rootMoves.begin() + 1, rootMoves.end());
+    }
+}
+
+AIEngine *createEngine()
+{
+    AIEngine *engine = new AIEngine();
+
+    initEvalWeights(engine->weights);
+    initNnueWeights(engine->network);
+    engine->evalMode = EVAL_PATTERNS;
+    initProbCutParams(engine->probCut);
+    engine->selectivity = PROBCUT_DEFAULT_SELECTIVITY;
+
+    engine->searchMode = SEARCH_ALPHABETA;
+    engine->cacheSize = 0;
+    engine->cacheFingerprint = 0;
+    engine->tableSize = TT_DEFAULT_SIZE_MB;
+    engine->mcts.root = NODE_NULL;
+    engine->threads.resize(1);
+    engine->endgameEmpties = ENDGAME_DEFAULT_EMPTIES;
+    engine->searchAborted = false;
+    engine->searchCancelled = false;
+    engine->workerDone = false;
+    engine->ponderingEnabled = true;
+    engine->maxDepth = 0;
+    engine->maxNodes = 0;
+    engine->infoCallback = nullptr;
+    engine->infoContext = nullptr;
+    engine->searchNodes = 0;
+    engine->endgameSearch = nullptr;
+
+    return engine;
+}
+
+void freeEngine(AIEngine *engine)
+{
+    cancelBestMoveSearch(*engine);
+    closeBook(engine->book);
+    closePositionCache(engine->cache);
+
+    delete engine;
+}
+
+// Suma FNV-1a de 64 bits de un bloque de memoria
+static uint64_t hashBytes(uint64_t hash, const void *data, size_t size)
+{
+    const uint8_t *bytes = (const uint8_t *)data;
+    for (size_t i = 0; i < size; i++)
+        hash = (hash ^ bytes[i]) * 0x100000001b3ULL;
+
+    return hash;
 }
 
-void freeTrees(Tree * node)
+// Identifica lo que determina los resultados guardados: el modo y los pesos
+// de la evaluacin, y la selectividad con sus parmetros de ProbCut (los
+// resultados podados no valen para una bsqueda de ancho completo)
+static uint64_t getCacheFingerprint(AIEngine &engine)
 {
-    // Tiene hijos para liberar?
-    if (node->sons.size() == 0) 
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    int mode = engine.evalMode;
+
+    hash = hashBytes(hash, &mode, sizeof(mode));
+    if (engine.evalMode == EVAL_NETWORK)
     {
-        counter = 0;
+        NnueWeights &network = engine.network;
+        hash = hashBytes(hash, network.featureWeights.data(), network.featureWeights.size() * sizeof(int16_t));
+        hash = hashBytes(hash, network.featureBiases.data(), network.featureBiases.size() * sizeof(int16_t));
+        hash = hashBytes(hash, network.layerWeights.data(), network.layerWeights.size() * sizeof(int8_t));
+        hash = hashBytes(hash, network.layerBiases.data(), network.layerBiases.size() * sizeof(int32_t));
+        hash = hashBytes(hash, network.outputWeights.data(), network.outputWeights.size() * sizeof(int8_t));
+        hash = hashBytes(hash, network.outputBiases.data(), network.outputBiases.size() * sizeof(int32_t));
+    }
+    else
+        hash = hashBytes(hash, engine.weights.values.data(), engine.weights.values.size() * sizeof(int16_t));
+
+    hash = hashBytes(hash, &engine.selectivity, sizeof(engine.selectivity));
+    if (engine.selectivity)
+        hash = hashBytes(hash, &engine.probCut, sizeof(engine.probCut));
+
+    return hash;
+}
+
+// Si cambi la evaluacin o la selectividad, vuelve a abrir la cach, que se
+// vaca si sus valores son de otra bsqueda
+static void updateCacheFingerprint(AIEngine &engine)
+{
+    if (!engine.cache.buckets || (engine.cacheFingerprint == getCacheFingerprint(engine)))
         return;
+
+    std::string path = engine.cachePath;
+    setPositionCache(engine, path.c_str(), engine.cacheSize);
+}
+
+bool setEvalWeights(AIEngine &engine, const char *path)
+{
+    cancelBestMoveSearch(engine);
+
+    bool loaded = loadEvalWeights(engine.weights, path);
+    updateCacheFingerprint(engine);
+
+    return loaded;
+}
+
+bool setEvalNetwork(AIEngine &engine, const char *path)
+{
+    cancelBestMoveSearch(engine);
+
+    bool loaded = loadNnueWeights(engine.network, path);
+    updateCacheFingerprint(engine);
+
+    return loaded;
+}
+
+void setEvalMode(AIEngine &engine, EvalMode mode)
+{
+    // La bsqueda en curso usa la tabla y los acumuladores de la evaluacin
+    cancelBestMoveSearch(engine);
+
+    engine.evalMode = mode;
+    engine.table.buckets.reset();
+    updateCacheFingerprint(engine);
+}
+
+bool setProbCutParams(AIEngine &engine, const char *path)
+{
+    // La bsqueda en curso lee los parmetros que se cargan
+    cancelBestMoveSearch(engine);
+
+    bool loaded = loadProbCutParams(engine.probCut, path);
+    updateCacheFingerprint(engine);
+
+    return loaded;
+}
+
+void setSelectivity(AIEngine &engine, int selectivity)
+{
+    if (selectivity < 0)
+        selectivity = 0;
+    if (selectivity >= PROBCUT_LEVELS)
+        selectivity = PROBCUT_LEVELS - 1;
+
+    engine.selectivity = selectivity;
+    updateCacheFingerprint(engine);
+}
+
+bool setOpeningBook(AIEngine &engine, const char *path)
+{
+    // La bsqueda en curso puede estar leyendo el libro que se cierra
+    cancelBestMoveSearch(engine);
+    closeBook(engine.book);
+
+    return openBook(engine.book, path);
+}
+
+bool setPositionCache(AIEngine &engine, const char *path, size_t megabytes)
+{
+    cancelBestMoveSearch(engine);
+    closePositionCache(engine.cache);
+
+    if (!path)
+        return true;
+
+    engine.cachePath = path;
+    engine.cacheSize = megabytes;
+    engine.cacheFingerprint = getCacheFingerprint(engine);
+
+    return openPositionCache(engine.cache, path, megabytes, engine.cacheFingerprint);
+}
+
+void setSearchMode(AIEngine &engine, SearchMode mode)
+{
+    engine.searchMode = mode;
+}
+
+void setHashSize(AIEngine &engine, size_t megabytes)
+{
+    // La bsqueda en curso usa la tabla o la pool que se liberan
+    cancelBestMoveSearch(engine);
+
+    engine.tableSize = megabytes;
+    engine.table.buckets.reset();
+    engine.mcts.pool.nodes.reset();
+    engine.mcts.root = NODE_NULL;
+}
+
+double getHashHitRate(AIEngine &engine)
+{
+    return getTranspositionHitRate(engine.tableStats);
+}
+
+double getCutoffFirstMoveRate(AIEngine &engine)
+{
+    return getFirstMoveCutoffRate(engine.orderingStats);
+}
+
+void setSearchThreads(AIEngine &engine, int threadCount)
+{
+    // La bsqueda en curso y los ayudantes usan los hilos que se liberan
+    cancelBestMoveSearch(engine);
+
+    if (threadCount < 1)
+        threadCount = 1;
+
+    engine.threads.resize(threadCount);
+}
+
+void setEndgameThreshold(AIEngine &engine, int emptySquares)
+{
+    engine.endgameEmpties = emptySquares;
+}
+
+void setSearchLimits(AIEngine &engine, int maxDepth, uint64_t maxNodes)
+{
+    engine.maxDepth = (maxDepth > 0) ? maxDepth : 0;
+    engine.maxNodes = maxNodes;
+}
+
+void setSearchInfoCallback(AIEngine &engine, SearchInfoCallback callback, void *context)
+{
+    engine.infoCallback = callback;
+    engine.infoContext = context;
+}
+
+SearchStats getSearchStats(AIEngine &engine)
+{
+    return engine.searchStats;
+}
+
+bool setSearchLog(AIEngine &engine, const char *path)
+{
+    if (engine.searchLog.is_open())
+        engine.searchLog.close();
+
+    if (!path)
+        return true;
+
+    engine.searchLog.open(path, std::ios::app);
+
+    return engine.searchLog.is_open();
+}
+
+// Prepara la tabla, los hilos y el reloj para una nueva bsqueda
+static void prepareSearch(AIEngine &engine, double timeBudget, uint64_t nodeBudget)
+{
+    if (!engine.table.buckets)
+        initTranspositionTable(engine.table, engine.tableSize);
+    ageTranspositionTable(engine.table);
+
+    for (size_t i = 0; i < engine.threads.size(); i++)
+    {
+        SearchThread &thread = engine.threads[i];
+        thread.engine = &engine;
+        thread.id = (int)i;
+        thread.counter = 0;
+        thread.orderingStats = OrderingStats();
+        thread.tableStats = TTStats();
+        thread.ply = 0;
+        thread.selectiveDepth = 0;
+        thread.probCutCuts = 0;
+        thread.moveGenSeconds = 0;
+        thread.evalSeconds = 0;
+        ageHistory(thread.history);
+    }
+
+    engine.endgameSeconds = 0;
+    getClockOverhead();
+    engine.searchStart = Clock::now();
+    engine.searchBudget = timeBudget;
+    engine.searchNodeBudget = nodeBudget;
+    engine.searchNodes = 0;
+    engine.searchAborted = false;
+}
+
+// Ordena las jugadas de la raz para la primera iteracin
+static void orderRootMoves(SearchThread &thread, GameModel &model, Moves &rootMoves)
+{
+    MoveList list;
+    orderMoves(list,
+               model,
+               getValidMovesBitboard(model),
+               TT_NO_MOVE,
+               thread.history,
+               true);
+
+    rootMoves.clear();
+    for (int i = 0; i < list.count; i++)
+        rootMoves.push_back(getIndexSquare(selectNextMove(list, i)));
+}
+
+// Variante principal: la mejor jugada y, a partir de ella, las mejores
+// jugadas guardadas en la tabla, mientras sean vlidas. Sin jugada (o si es
+// invlida) arranca por la jugada guardada para la posicin
+static void getPrincipalVariation(AIEngine &engine, GameModel model, Square bestMove, int maxLength, Moves &pv)
+{
+    TTStats tableStats;
+    int index = isSquareValid(bestMove) ? getSquareIndex(bestMove) : TT_NO_MOVE;
+
+    pv.clear();
+    while ((int)pv.size() < maxLength)
+    {
+        uint64_t moves = getValidMovesBitboard(model);
+        if (!moves)
+        {
+            Player opponent = (model.currentPlayer == PLAYER_WHITE) ? PLAYER_BLACK : PLAYER_WHITE;
+            if (!getMovesBitboard(model.board[opponent], model.board[model.currentPlayer]))
+                break;
+
+            makePass(model);
+            continue;
+        }
+
+        if (index == TT_NO_MOVE)
+        {
+            TTEntry entry;
+            if (!engine.table.buckets ||
+                !probeTranspositionTable(engine.table, model.hash, entry, tableStats))
+                break;
+            index = entry.bestMove;
+        }
+        if ((index == TT_NO_MOVE) || !(moves & squareBit(index)))
+            break;
+
+        pv.push_back(getIndexSquare(index));
+        makeMove(model, index);
+        index = TT_NO_MOVE;
     }
-    for(auto i = 0 ; node->sons.size() > i ; i++)
+}
+
+// Estadsticas de la bsqueda, sumando todos los hilos
+static void collectSearchStats(AIEngine &engine, GameModel &model, Square bestMove, int completedDepth, int score)
+{
+    SearchStats &stats = engine.searchStats;
+
+    stats = SearchStats();
+    stats.threads = (int)engine.threads.size();
+    stats.depth = completedDepth;
+    stats.selectiveDepth = completedDepth;
+    stats.score = score;
+    stats.seconds = getElapsedTime(engine);
+    stats.endgameSeconds = engine.endgameSeconds;
+    for (auto &thread : engine.threads)
     {
-        freeTrees(node->sons[i]);
+        stats.nodes += thread.counter;
+        stats.hashProbes += thread.tableStats.probes;
+        stats.hashHits += thread.tableStats.hits;
+        stats.cutoffs += thread.orderingStats.cutoffs;
+        stats.firstMoveCutoffs += thread.orderingStats.firstMoveCutoffs;
+        stats.probCutCuts += thread.probCutCuts;
+        stats.moveGenSeconds += PROFILE_SAMPLE_NODES * thread.moveGenSeconds;
+        stats.evalSeconds += PROFILE_SAMPLE_NODES * thread.evalSeconds;
+        if (thread.selectiveDepth > stats.selectiveDepth)
+            stats.selectiveDepth = thread.selectiveDepth;
+
+        engine.tableStats.probes += thread.tableStats.probes;
+        engine.tableStats.hits += thread.tableStats.hits;
+        engine.orderingStats.cutoffs += thread.orderingStats.cutoffs;
+        engine.orderingStats.firstMoveCutoffs += thread.orderingStats.firstMoveCutoffs;
     }
+    stats.nodesPerSecond = (stats.seconds > 0) ? stats.nodes / stats.seconds : 0;
+
+    // Lo que no es generacin, evaluacin ni final exacto es la bsqueda
+    // misma: tabla, hacer y deshacer jugadas, recursin
+    stats.searchSeconds = stats.seconds * stats.threads -
+                          stats.moveGenSeconds - stats.evalSeconds - stats.endgameSeconds;
+    if (stats.searchSeconds < 0)
+        stats.searchSeconds = 0;
+
+    getPrincipalVariation(engine, model, bestMove, std::max(completedDepth, 1), stats.principalVariation);
+}
+
+// Progreso de la bsqueda tras cada iteracin. Los nodos de los hilos
+// auxiliares se cuentan de a TIME_CHECK_NODES, sin leer sus contadores
+static void reportSearchInfo(AIEngine &engine, GameModel &model, Square bestMove, int depth, int score)
+{
+    SearchStats info = SearchStats();
+    SearchThread &mainThread = engine.threads[0];
+
+    info.threads = (int)engine.threads.size();
+    info.depth = depth;
+    info.selectiveDepth = std::max(mainThread.selectiveDepth, depth);
+    info.score = score;
+    info.nodes = engine.searchNodes + mainThread.counter % TIME_CHECK_NODES;
+    info.seconds = getElapsedTime(engine);
+    info.nodesPerSecond = (info.seconds > 0) ? info.nodes / info.seconds : 0;
+    getPrincipalVariation(engine, model, bestMove, std::max(depth, 1), info.principalVariation);
+
+    engine.infoCallback(engine.infoContext, info);
+}
 
-    delete node;
+static void writeSquare(std::ostream &stream, Square square)
+{
+    stream << (char)('a' + square.x) << (char)('1' + square.y);
+}
+
+// Una lnea JSON por jugada, para seguir el rendimiento entre versiones
+static void writeSearchLog(AIEngine &engine, GameModel &model, Square move)
+{
+    SearchStats &stats = engine.searchStats;
+    std::ostream &log = engine.searchLog;
 
+    log << "{\"time\":" << (long long)std::time(nullptr)
+        << ",\"player\":\"" << ((model.currentPlayer == PLAYER_BLACK) ? "black" : "white") << "\""
+        << ",\"empties\":" << getEmptySquares(model)
+        << ",\"move\":\"";
+    writeSquare(log, move);
+    log << "\",\"book\":" << (stats.book ? "true" : "false")
+        << ",\"cache\":" << (stats.cache ? "true" : "false")
+        << ",\"depth\":" << stats.depth
+        << ",\"reusedDepth\":" << stats.reusedDepth
+        << ",\"selectiveDepth\":" << stats.selectiveDepth
+        << ",\"score\":" << stats.score
+        << ",\"pv\":\"";
+    for (auto pvMove : stats.principalVariation)
+        writeSquare(log, pvMove);
+    log << "\",\"threads\":" << stats.threads
+        << ",\"nodes\":" << stats.nodes
+        << ",\"seconds\":" << stats.seconds
+        << ",\"nodesPerSecond\":" << (uint64_t)stats.nodesPerSecond
+        << ",\"hashProbes\":" << stats.hashProbes
+        << ",\"hashHits\":" << stats.hashHits
+        << ",\"cutoffs\":" << stats.cutoffs
+        << ",\"firstMoveCutoffs\":" << stats.firstMoveCutoffs
+        << ",\"probCutCuts\":" << stats.probCutCuts
+        << ",\"moveGenSeconds\":" << stats.moveGenSeconds
+        << ",\"evalSeconds\":" << stats.evalSeconds
+        << ",\"endgameSeconds\":" << stats.endgameSeconds
+        << ",\"searchSeconds\":" << stats.searchSeconds
+        << "}" << std::endl;
 }
 
-Square getBestMove(GameModel &model)
+static bool isMctsAborted(void *context)
 {
-    Piece oppPiece =
-        (getCurrentPlayer(model) == PLAYER_WHITE)
-        ? PIECE_BLACK
-        : PIECE_WHITE;
-    
-    Piece selfPiece =
-        (getCurrentPlayer(model) == PLAYER_WHITE)
-        ? PIECE_WHITE
-        : PIECE_BLACK;
+    AIEngine &engine = *(AIEngine *)context;
 
-    Moves validMoves;
+    checkSearchTime(engine, engine.mcts.playouts);
 
-    // Genera el rbol
-    Tree root;
-    root.sim = model;
+    return engine.searchAborted;
+}
+
+// Bsqueda de Monte Carlo con el tiempo y las simulaciones dados (0 es sin lmite)
+static int runMctsSearch(AIEngine &engine, GameModel &model, double timeBudget, uint64_t maxPlayouts, Square &bestMove)
+{
+    if (!engine.mcts.pool.nodes)
+        initMctsSearch(engine.mcts, engine.tableSize);
+
+    engine.searchStart = Clock::now();
+    engine.searchBudget = timeBudget;
+    engine.searchNodeBudget = 0;
+    engine.searchAborted = false;
+
+    engine.mcts.threads = (int)engine.threads.size();
+    engine.mcts.maxPlayouts = maxPlayouts;
+    engine.mcts.isAborted = isMctsAborted;
+    engine.mcts.context = &engine;
+
+    return searchMcts(engine.mcts, model, bestMove);
+}
+
+static Square searchMctsMove(AIEngine &engine, GameModel &model, double timeBudget)
+{
+    Square bestMove;
+    int score = runMctsSearch(engine, model, timeBudget, engine.maxNodes, bestMove);
 
-    getValidMoves(root.sim, validMoves);
+    // Las simulaciones cuentan como nodos, y la profundidad es la del rbol
+    SearchStats &stats = engine.searchStats;
+    stats = SearchStats();
+    stats.threads = engine.mcts.threads;
+    stats.depth = engine.mcts.depth;
+    stats.selectiveDepth = stats.depth;
+    stats.score = score;
+    stats.nodes = engine.mcts.playouts;
+    stats.seconds = getElapsedTime(engine);
+    stats.nodesPerSecond = (stats.seconds > 0) ? stats.nodes / stats.seconds : 0;
+    stats.searchSeconds = stats.seconds * stats.threads;
+    getMctsPrincipalVariation(engine.mcts, std::max(stats.depth, 1), stats.principalVariation);
 
-    for(auto i = 0 ; i < validMoves.size() ; i++)
+    if (engine.infoCallback)
+        engine.infoCallback(engine.infoContext, stats);
+
+    return bestMove;
+}
+
+// Hilo de la bsqueda en segundo plano: trabaja sobre su propia copia del modelo
+static void searchWorker(AIEngine *engine, GameModel model, double timeBudget)
+{
+    engine->workerMove = getBestMove(*engine, model, timeBudget);
+    engine->workerDone = true;
+}
+
+// Hilo de anlisis durante el turno del humano: profundiza de a un nivel
+// todas las respuestas posibles del humano, guardando para cada una la mejor
+// jugada de la IA. La tabla queda cargada para la bsqueda siguiente
+static void ponderWorker(AIEngine *engine, GameModel model)
+{
+    SearchThread &thread = engine->threads[0];
+    std::vector<PonderResult> &ponderResults = engine->ponderResults;
+
+    // Con Monte Carlo, el rbol del turno del humano: la bsqueda siguiente
+    // contina desde el subrbol de la jugada que elija
+    if (engine->searchMode == SEARCH_MCTS)
     {
-        drawView(model);
-        populateTree(&root, validMoves, i);
+        Square move;
+        if (getValidMovesBitboard(model))
+            runMctsSearch(*engine, model, NO_TIME_LIMIT, 0, move);
+
+        engine->workerDone = true;
+        return;
     }
 
-    int minMax = -64;
-    Square bestMove = {0, 0};
+    prepareSearch(*engine, NO_TIME_LIMIT, 0);
 
-    for (auto i = 0; i < root.sons.size(); i++)
+    ponderResults.clear();
+    for (uint64_t moves = getValidMovesBitboard(model); moves; moves &= moves - 1)
     {
-        int sonVal= functionMinMax(root.sons[i]);
-        if (minMax < sonVal)
+        PonderResult result;
+        result.model = model;
+        playMove(result.model, getIndexSquare(firstBit(moves)));
+
+        // Si la IA tiene que pasar, el humano vuelve a jugar: no hay nada que analizar
+        if (result.model.gameOver || (result.model.currentPlayer == model.currentPlayer))
+            continue;
+
+        orderRootMoves(thread, result.model, result.rootMoves);
+        result.move = result.rootMoves[0];
+        result.score = 0;
+        result.depth = 0;
+        result.emptySquares = getEmptySquares(result.model);
+        result.seconds = 0;
+        ponderResults.push_back(result);
+    }
+
+    for (int depth = 1; depth <= MAX_SEARCH_DEPTH; depth++)
+    {
+        bool pending = false;
+
+        for (auto &result : ponderResults)
         {
-            minMax = sonVal;
-            bestMove = root.sons[i]->move;
+            // Ya se analiz hasta el final del juego?
+            if (result.depth >= result.emptySquares)
+                continue;
+            pending = true;
+
+            double start = getElapsedTime(*engine);
+            Square iterationMove = result.move;
+            bool completed = searchRoot(thread,
+                                        result.model,
+                                        result.rootMoves,
+                                        depth,
+                                        iterationMove,
+                                        result.score);
+            result.seconds += getElapsedTime(*engine) - start;
+            if (!completed)
+            {
+                engine->workerDone = true;
+                return;
+            }
+
+            result.move = iterationMove;
+            result.depth = depth;
+            moveToFront(result.rootMoves, iterationMove);
         }
+
+        if (!pending)
+            break;
     }
 
-    for (auto i = 0; i < root.sons.size(); i++)
-        freeTrees(root.sons[i]);
-    
+    engine->workerDone = true;
+}
+
+int getSearchScore(AIEngine &engine, GameModel &model, int depth)
+{
+    prepareSearch(engine, NO_TIME_LIMIT, 0);
+
+    SearchThread &thread = engine.threads[0];
+    GameModel node = model;
+    initSearchEval(thread, node);
+
+    thread.ply = 0;
+
+    int score = functionNegamax(thread, node, depth, -SCORE_INFINITY, SCORE_INFINITY);
+    collectSearchStats(engine, model, GAME_INVALID_SQUARE, depth, score);
+
+    return score;
+}
+
+void startBestMoveSearch(AIEngine &engine, GameModel &model, double timeBudget)
+{
+    cancelBestMoveSearch(engine);
+
+    engine.searchCancelled = false;
+    engine.workerDone = false;
+    engine.workerTask = TASK_SEARCH;
+    engine.worker = std::thread(searchWorker, &engine, model, timeBudget);
+}
+
+bool isBestMoveSearchRunning(AIEngine &engine)
+{
+    return engine.worker.joinable() && (engine.workerTask == TASK_SEARCH);
+}
+
+bool pollBestMoveSearch(AIEngine &engine, Square &move)
+{
+    if (!isBestMoveSearchRunning(engine) || !engine.workerDone)
+        return false;
+
+    engine.worker.join();
+    move = engine.workerMove;
+
+    return true;
+}
+
+void cancelBestMoveSearch(AIEngine &engine)
+{
+    if (!engine.worker.joinable())
+        return;
+
+    engine.searchCancelled = true;
+    engine.worker.join();
+    engine.searchCancelled = false;
+}
+
+void setPondering(AIEngine &engine, bool enabled)
+{
+    engine.ponderingEnabled = enabled;
+}
+
+void startPondering(AIEngine &engine, GameModel &model)
+{
+    cancelBestMoveSearch(engine);
+
+    if (!engine.ponderingEnabled)
+        return;
+
+    engine.searchCancelled = false;
+    engine.workerDone = false;
+    engine.workerTask = TASK_PONDER;
+    engine.worker = std::thread(ponderWorker, &engine, model);
+}
+
+bool isPondering(AIEngine &engine)
+{
+    return engine.worker.joinable() && (engine.workerTask == TASK_PONDER);
+}
+
+double getTimeBudget(GameModel &model)
+{
+    Player aiPlayer = getCurrentPlayer(model);
+    int emptySquares = BOARD_SIZE * BOARD_SIZE -
+                       countBits(model.board[PLAYER_BLACK] | model.board[PLAYER_WHITE]);
+
+    // Reparte el reloj restante entre las jugadas que le quedan a la IA,
+    // guardando un margen de dos jugadas
+    double remainingTime = AI_GAME_TIME - getTimer(model, aiPlayer);
+    int remainingMoves = (emptySquares + 1) / 2 + 2;
+    double budget = remainingTime / remainingMoves;
+
+    if (budget < AI_MIN_MOVE_TIME)
+        budget = AI_MIN_MOVE_TIME;
+    if (budget > AI_MAX_MOVE_TIME)
+        budget = AI_MAX_MOVE_TIME;
+
+    return budget;
+}
+
+// Guarda en el cach persistente el resultado de la raz, que la bsqueda
+// no guarda (slo recorre sus jugadas). El valor de la mejor jugada es exacto
+static void storeRootResult(AIEngine &engine, GameModel &model, Square bestMove, int completedDepth, int score)
+{
+    if (engine.cache.buckets && (completedDepth >= CACHE_MIN_DEPTH))
+        storePositionCache(engine.cache, model, completedDepth, BOUND_EXACT, score, getSquareIndex(bestMove));
+}
+
+static Square searchBestMove(AIEngine &engine, GameModel &model, double timeBudget)
+{
+    Moves rootMoves;
+    getValidMoves(model, rootMoves);
+
+    // Jugada forzada: no hay nada que buscar
+    if (rootMoves.size() == 1)
+    {
+        engine.searchStats = SearchStats();
+        engine.searchStats.threads = (int)engine.threads.size();
+        engine.searchStats.principalVariation = rootMoves;
+
+        return rootMoves[0];
+    }
+
+    // Jugada del libro de aperturas, sin buscar
+    Square bookMove;
+    int bookScore;
+    if (probeBook(engine.book, model, bookMove, bookScore))
+    {
+        engine.searchStats = SearchStats();
+        engine.searchStats.threads = (int)engine.threads.size();
+        engine.searchStats.score = bookScore;
+        engine.searchStats.book = true;
+        engine.searchStats.principalVariation.push_back(bookMove);
+
+        return bookMove;
+    }
+
+    if (engine.searchMode == SEARCH_MCTS)
+        return searchMctsMove(engine, model, timeBudget);
+
+    int emptySquares = getEmptySquares(model);
+
+    // Resultado de una sesin anterior: si ya llega al final del juego (o al
+    // lmite de profundidad) se juega sin buscar, y si no, su jugada se busca
+    // primero
+    TTEntry cacheEntry;
+    bool cached = engine.cache.buckets &&
+                  probePositionCache(engine.cache, model, cacheEntry) &&
+                  (cacheEntry.bestMove != TT_NO_MOVE) &&
+                  (getValidMovesBitboard(model) & squareBit(cacheEntry.bestMove));
+    if (cached && (cacheEntry.bound == BOUND_EXACT) &&
+        ((cacheEntry.depth >= emptySquares) || (engine.maxDepth && (cacheEntry.depth >= engine.maxDepth))))
+    {
+        Square cacheMove = getIndexSquare(cacheEntry.bestMove);
+
+        engine.searchStats = SearchStats();
+        engine.searchStats.threads = (int)engine.threads.size();
+        engine.searchStats.depth = cacheEntry.depth;
+        engine.searchStats.selectiveDepth = cacheEntry.depth;
+        engine.searchStats.score = cacheEntry.score;
+        engine.searchStats.cache = true;
+        engine.searchStats.principalVariation.push_back(cacheMove);
+
+        return cacheMove;
+    }
+
+    prepareSearch(engine, timeBudget, engine.maxNodes);
+
+    SearchThread &mainThread = engine.threads[0];
+    int maxDepth = engine.maxDepth ? std::min(engine.maxDepth, MAX_SEARCH_DEPTH) : MAX_SEARCH_DEPTH;
+
+    // Primera iteracin: las jugadas de la raz en el orden de la bsqueda
+    orderRootMoves(mainThread, model, rootMoves);
+    if (cached)
+        moveToFront(rootMoves, getIndexSquare(cacheEntry.bestMove));
+
+    Square bestMove = rootMoves[0];
+    int bestScore = 0;
+    int startDepth = 1;
+    int completedDepth = 0;
+    double ponderedSeconds = 0;
+
+    // El humano jug una respuesta ya analizada? Se contina desde la
+    // profundidad alcanzada, o se responde en el acto si el anlisis ya lleg
+    // al final del juego o ya us el tiempo de esta jugada
+    for (auto &result : engine.ponderResults)
+        if ((result.model.hash == model.hash) && (result.depth > 0))
+        {
+            rootMoves = result.rootMoves;
+            bestMove = result.move;
+            bestScore = result.score;
+            startDepth = result.depth + 1;
+            completedDepth = result.depth;
+            ponderedSeconds = result.seconds;
+        }
+    engine.ponderResults.clear();
+
+    // La bsqueda anterior ya analiz esta posicin? Tras la jugada de la IA
+    // y la respuesta esperada, el subrbol de la variante principal sigue en
+    // la tabla con su profundidad y su mejor jugada: se contina desde ah
+    TTEntry entry;
+    if ((completedDepth == 0) &&
+        probeTranspositionTable(engine.table, model.hash, entry, mainThread.tableStats) &&
+        (entry.bound == BOUND_EXACT) && (entry.depth > 0) &&
+        (entry.bestMove != TT_NO_MOVE) &&
+        (getValidMovesBitboard(model) & squareBit(entry.bestMove)))
+    {
+        bestMove = getIndexSquare(entry.bestMove);
+        bestScore = entry.score;
+        completedDepth = std::min(entry.depth, emptySquares);
+        startDepth = completedDepth + 1;
+        moveToFront(rootMoves, bestMove);
+    }
+    int reusedDepth = completedDepth;
+
+    if ((completedDepth > 0) &&
+        ((completedDepth >= emptySquares) || (completedDepth >= maxDepth) ||
+         (ponderedSeconds >= timeBudget)))
+    {
+        storeRootResult(engine, model, bestMove, completedDepth, bestScore);
+        collectSearchStats(engine, model, bestMove, completedDepth, bestScore);
+        engine.searchStats.reusedDepth = reusedDepth;
+        return bestMove;
+    }
+
+    // Los hilos auxiliares slo llenan la tabla compartida
+    std::vector<std::thread> helpers;
+    for (size_t i = 1; i < engine.threads.size(); i++)
+        helpers.push_back(std::thread(helperSearch,
+                                      std::ref(engine.threads[i]),
+                                      model,
+                                      rootMoves,
+                                      emptySquares));
+
+    // Cerca del final, la bsqueda normal slo deja una jugada de respaldo
+    // para el caso en que no alcance el tiempo para resolver el final exacto
+    // Con lmite de profundidad, slo si el lmite llega al final del juego
+    bool endgame = (emptySquares <= engine.endgameEmpties) && (maxDepth >= emptySquares);
+
+    // Profundizacin iterativa: cada iteracin completa reemplaza a la anterior
+    for (int depth = startDepth; depth <= maxDepth; depth++)
+    {
+        Square iterationMove = bestMove;
+        int iterationScore;
+        if (!searchRoot(mainThread, model, rootMoves, depth, iterationMove, iterationScore))
+            break;
+
+        bestMove = iterationMove;
+        bestScore = iterationScore;
+        completedDepth = depth;
+
+        // La prxima iteracin arranca por la mejor jugada de esta
+        moveToFront(rootMoves, bestMove);
+
+        if (engine.infoCallback)
+            reportSearchInfo(engine, model, bestMove, depth, bestScore);
+
+        // Se lleg al final del juego, o no alcanza el tiempo para otra iteracin?
+        if (depth >= emptySquares || getElapsedTime(engine) >= timeBudget / 2 ||
+            (endgame && (depth >= ENDGAME_FALLBACK_DEPTH)))
+            break;
+    }
+
+    engine.searchAborted = true;
+    for (auto &helper : helpers)
+        helper.join();
+
+    // Final exacto con el resto del tiempo
+    if (endgame && (completedDepth < emptySquares))
+    {
+        EndgameSearch search = EndgameSearch();
+        search.table = &engine.table;
+        search.isAborted = isEndgameAborted;
+        search.context = &engine;
+        engine.endgameSearch = &search;
+
+        engine.searchAborted = false;
+        Clock::time_point endgameStart = Clock::now();
+        Square endgameMove = bestMove;
+        int endgameScore = solveEndgame(search, model, endgameMove);
+        engine.endgameSeconds = getSeconds(endgameStart);
+
+        mainThread.counter += search.nodes;
+        engine.searchNodes += search.nodes;
+        mainThread.tableStats.probes += search.tableStats.probes;
+        mainThread.tableStats.hits += search.tableStats.hits;
+        if (!search.aborted)
+        {
+            bestMove = endgameMove;
+            bestScore = endgameScore;
+            completedDepth = emptySquares;
+
+            if (engine.infoCallback)
+                reportSearchInfo(engine, model, bestMove, completedDepth, bestScore);
+        }
+        engine.endgameSearch = nullptr;
+    }
+
+    storeRootResult(engine, model, bestMove, completedDepth, bestScore);
+    collectSearchStats(engine, model, bestMove, completedDepth, bestScore);
+    engine.searchStats.reusedDepth = reusedDepth;
+
     return bestMove;
-    
-}
\ No newline at end of file
+}
+
+Square getBestMove(AIEngine &engine, GameModel &model, double timeBudget)
+{
+    if (!getValidMovesBitboard(model))
+        return GAME_INVALID_SQUARE;
+
+    Square move = searchBestMove(engine, model, timeBudget);
+
+    // Los resultados nuevos se escriben al archivo en segundo plano
+    flushPositionCache(engine.cache);
+
+    if (engine.searchLog.is_open())
+        writeSearchLog(engine, model, move);
+
+    return move;
+}
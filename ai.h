@@ -8,23 +8,420 @@
 #ifndef AI_H
 #define AI_H
 
+#include <cstddef>
+
 #include "model.h"
 
-#define COTA_NIVELES 2500
+#define MAX_SEARCH_DEPTH (BOARD_SIZE * BOARD_SIZE)
+
+// Time control used to budget the AI's clock (seconds per game)
+#define AI_GAME_TIME 180.0
+#define AI_MIN_MOVE_TIME 0.05
+#define AI_MAX_MOVE_TIME 10.0
+
+// Time budget of the searches without time limit (see setSearchLimits)
+#define NO_TIME_LIMIT 1e9
+
+#define TT_DEFAULT_SIZE_MB 64
+
+// Search algorithm of getBestMove
+enum SearchMode
+{
+    // Iterative deepening alpha-beta with the exact endgame solver
+    SEARCH_ALPHABETA,
+    // Monte Carlo tree search (see mcts.h)
+    SEARCH_MCTS,
+};
 
-class Tree {
-public:
-	Square move; // posicin del movimiento hecho 
-	GameModel sim; // simulacin del movimiento en el tablero correspondiente
-	int value; // diferencia entre las fichas de la ia y las fichas del humano 
-	std::vector<Tree *> sons; // nodos hijos
+// Evaluation function of the alpha-beta search
+enum EvalMode
+{
+    // Pattern weights (see eval.h)
+    EVAL_PATTERNS,
+    // Quantized neural network (see nnue.h)
+    EVAL_NETWORK,
 };
 
+// Statistics of one move's search. Counts are summed over all threads
+struct SearchStats
+{
+    int threads;
+    int depth;
+    // Depth already known when the search started (from pondering or from the
+    // previous move's search), where the iterations continued
+    int reusedDepth;
+    // Deepest ply reached, counting passes and selective searches
+    int selectiveDepth;
+    // Score of the move: estimated final disc difference for the side to move
+    // (exact if the depth reached the end of the game, since ProbCut only
+    // prunes searches that stop before it)
+    int score;
+    // The move played in the book (without searching)
+    bool book;
+    // The move played from the position cache (without searching)
+    bool cache;
+    // The move and the expected replies, as far as the transposition table knows
+    Moves principalVariation;
+
+    uint64_t nodes;
+    double seconds;
+    double nodesPerSecond;
+
+    uint64_t hashProbes;
+    uint64_t hashHits;
+    uint64_t cutoffs;
+    uint64_t firstMoveCutoffs;
+    uint64_t probCutCuts;
+
+    // Thread time split between move generation (and ordering), leaf
+    // evaluation, the exact endgame solver and the rest of the search. The
+    // first two are estimated by timing a sample of the nodes
+    double moveGenSeconds;
+    double evalSeconds;
+    double endgameSeconds;
+    double searchSeconds;
+};
+
+/**
+ * @brief Receives the progress of a search after each completed iteration.
+ *
+ * Only the depth, selective depth, score, principal variation, nodes,
+ * seconds and nodes per second are filled in. Called from the searching
+ * thread.
+ */
+typedef void (*SearchInfoCallback)(void *context, const SearchStats &stats);
+
+/**
+ * @brief An AI engine: its transposition table, search threads, clock and
+ * background worker. Engines are independent, so several of them can play
+ * in the same process (see the arena).
+ */
+struct AIEngine;
+
+/**
+ * @brief Creates an AI engine with the default settings.
+ *
+ * @return The engine (release it with freeEngine).
+ */
+AIEngine *createEngine();
+
+/**
+ * @brief Cancels any background search of an engine and releases it.
+ *
+ * @param engine The engine.
+ */
+void freeEngine(AIEngine *engine);
+
+/**
+ * @brief Loads the pattern evaluation weights of an engine from a file.
+ *
+ * Engines start with the built-in heuristic weights (see eval.h). Any
+ * background search or pondering is cancelled first.
+ *
+ * @param engine The engine.
+ * @param path The weights file.
+ * @return Whether the file was loaded (the weights are unchanged otherwise).
+ */
+bool setEvalWeights(AIEngine &engine, const char *path);
+
+/**
+ * @brief Loads the neural network evaluation weights of an engine from a file.
+ *
+ * Engines start with a network built from the heuristic (see nnue.h). The
+ * network is only used in EVAL_NETWORK mode (see setEvalMode). Any
+ * background search or pondering is cancelled first.
+ *
+ * @param engine The engine.
+ * @param path The network file.
+ * @return Whether the file was loaded (the network is unchanged otherwise).
+ */
+bool setEvalNetwork(AIEngine &engine, const char *path);
+
+/**
+ * @brief Selects the evaluation function of the search (patterns by default).
+ *
+ * Any background search or pondering is cancelled first. The transposition
+ * table is cleared, since its values came from the other evaluation.
+ *
+ * @param engine The engine.
+ * @param mode The evaluation function.
+ */
+void setEvalMode(AIEngine &engine, EvalMode mode);
+
+/**
+ * @brief Loads the Multi-ProbCut parameters of an engine from a file.
+ *
+ * Engines start with the built-in parameters (see probcut.h); files are
+ * written by the probcutfit tool. Any background search or pondering is
+ * cancelled first.
+ *
+ * @param engine The engine.
+ * @param path The parameters file.
+ * @return Whether the file was loaded (the parameters are unchanged otherwise).
+ */
+bool setProbCutParams(AIEngine &engine, const char *path);
+
+/**
+ * @brief Sets how selective the midgame search is.
+ *
+ * Level 0 searches full width; higher levels prune with Multi-ProbCut at
+ * lower confidence, reaching deeper in the same time at the risk of
+ * missing more moves. The endgame solver is always exact.
+ *
+ * @param engine The engine.
+ * @param selectivity The level (0 to PROBCUT_LEVELS - 1, PROBCUT_DEFAULT_SELECTIVITY by default).
+ */
+void setSelectivity(AIEngine &engine, int selectivity);
+
+/**
+ * @brief Opens the opening book of an engine (see book.h).
+ *
+ * getBestMove plays the book move, without searching, when the position is
+ * in the book. Any background search or pondering is cancelled and any book
+ * already open is closed first.
+ *
+ * @param engine The engine.
+ * @param path The book file.
+ * @return Whether the book was opened.
+ */
+bool setOpeningBook(AIEngine &engine, const char *path);
+
+/**
+ * @brief Opens the persistent position cache of an engine (see cache.h).
+ *
+ * Searches look up and store their deeper nodes in the cache, so results
+ * carry over between moves, games and runs. getBestMove plays the cached
+ * move, without searching, when the cache holds an exact result that reaches
+ * the end of the game (or the depth limit), and otherwise searches it first.
+ * Any cache already open is closed first. The file is emptied if its scores
+ * came from another evaluation (mode and weights) or selectivity (level and
+ * ProbCut parameters); changing them later opens the file again the same way.
+ *
+ * @param engine The engine.
+ * @param path The cache file (created if missing), or nullptr to close the cache.
+ * @param megabytes The size of a new file (see CACHE_DEFAULT_SIZE_MB).
+ * @return Whether the cache was opened.
+ */
+bool setPositionCache(AIEngine &engine, const char *path, size_t megabytes);
+
+/**
+ * @brief Selects the search algorithm of getBestMove (alpha-beta by default).
+ *
+ * In MCTS mode the search threads grow one shared tree, the node limit of
+ * setSearchLimits counts playouts (and the depth limit is ignored), the
+ * search uses the whole time budget, and pondering grows the tree of the
+ * human's turn, so the AI continues from the subtree of the human's move.
+ * The book still applies; the position cache does not.
+ *
+ * @param engine The engine.
+ * @param mode The search algorithm.
+ */
+void setSearchMode(AIEngine &engine, SearchMode mode);
+
+/**
+ * @brief Sets the size of the transposition table shared by the searches
+ * (or, in MCTS mode, of the node pool of the tree).
+ *
+ * Any background search or pondering is cancelled first. The table (or
+ * pool) is reallocated (and cleared) on the next search.
+ *
+ * @param engine The engine.
+ * @param megabytes The table size in megabytes.
+ */
+void setHashSize(AIEngine &engine, size_t megabytes);
+
+/**
+ * @brief Returns the transposition table hit rate since it was allocated.
+ *
+ * @param engine The engine.
+ * @return The fraction of probes that found their position (0 to 1).
+ */
+double getHashHitRate(AIEngine &engine);
+
+/**
+ * @brief Returns how often the first ordered move caused the cutoff.
+ *
+ * @param engine The engine.
+ * @return The fraction of cutoffs caused by the first move (0 to 1).
+ */
+double getCutoffFirstMoveRate(AIEngine &engine);
+
+/**
+ * @brief Sets the number of search threads.
+ *
+ * With more than one thread the search runs Lazy SMP: helper threads search
+ * the same root and share the lock-free transposition table, while the main
+ * thread's iterations decide the move. One thread (the default) is fully
+ * deterministic. Any background search or pondering is cancelled first.
+ *
+ * @param engine The engine.
+ * @param threadCount The number of threads (at least one).
+ */
+void setSearchThreads(AIEngine &engine, int threadCount);
+
+/**
+ * @brief Sets from how many empty squares the exact endgame solver is used.
+ *
+ * At or below the threshold, getBestMove runs a shallow search for a
+ * fallback move and then solves the position exactly with the rest of the
+ * time budget.
+ *
+ * @param engine The engine.
+ * @param emptySquares The threshold (ENDGAME_DEFAULT_EMPTIES by default).
+ */
+void setEndgameThreshold(AIEngine &engine, int emptySquares);
+
+/**
+ * @brief Limits the depth and nodes of the searches of getBestMove.
+ *
+ * The limits apply on top of the time budget (pass NO_TIME_LIMIT to search
+ * by depth or nodes only). With a depth limit, the exact endgame solver only
+ * runs if the limit reaches the end of the game. Nodes are summed over all
+ * threads and checked every few thousand nodes, so a search may overshoot
+ * the node limit slightly.
+ *
+ * @param engine The engine.
+ * @param maxDepth The deepest iteration (0 for no limit, the default).
+ * @param maxNodes The most nodes (0 for no limit, the default).
+ */
+void setSearchLimits(AIEngine &engine, int maxDepth, uint64_t maxNodes);
+
+/**
+ * @brief Sets a function that receives the progress of each search of
+ * getBestMove, after every completed iteration.
+ *
+ * @param engine The engine.
+ * @param callback The function, or nullptr to stop reporting.
+ * @param context Passed to the function.
+ */
+void setSearchInfoCallback(AIEngine &engine, SearchInfoCallback callback, void *context);
+
+/**
+ * @brief Returns the statistics of the last search.
+ *
+ * Nodes are summed over all threads, so nodes per second measures the
+ * scaling of the thread count.
+ *
+ * @param engine The engine.
+ * @return The search statistics.
+ */
+SearchStats getSearchStats(AIEngine &engine);
+
+/**
+ * @brief Appends the statistics of every move chosen by getBestMove to a log.
+ *
+ * Each move is one line of JSON (JSON Lines) with the fields of SearchStats,
+ * the position's side to move and empty squares, the move, and a Unix
+ * timestamp. Squares are written as "d3", and the principal variation as a
+ * move list ("d3c5f6").
+ *
+ * @param engine The engine.
+ * @param path The log file, or nullptr to stop logging.
+ * @return Whether the log was opened.
+ */
+bool setSearchLog(AIEngine &engine, const char *path);
+
+/**
+ * @brief Returns the time budget for the AI's next move.
+ *
+ * The remaining clock is split over the AI's expected remaining moves,
+ * estimated from the number of empty squares.
+ *
+ * @param model The game model.
+ * @return The time budget in seconds.
+ */
+double getTimeBudget(GameModel &model);
+
 /**
  * @brief Returns the best move for a certain position.
  *
+ * Searches with iterative deepening until the time budget runs out, and
+ * returns the best move of the last fully completed iteration.
+ *
+ * @param engine The engine.
+ * @param model The game model.
+ * @param timeBudget The time budget in seconds.
  * @return The best move.
  */
-Square getBestMove(GameModel &model);
+Square getBestMove(AIEngine &engine, GameModel &model, double timeBudget);
+
+/**
+ * @brief Searches a position to a fixed depth, without time limit.
+ *
+ * Uses the main thread only, with the engine's selectivity.
+ *
+ * @param engine The engine.
+ * @param model The position.
+ * @param depth The depth (0 evaluates the position).
+ * @return The score for the side to move.
+ */
+int getSearchScore(AIEngine &engine, GameModel &model, int depth);
+
+/**
+ * @brief Starts searching the best move on a background thread.
+ *
+ * The search works on a snapshot of the model, so the caller may keep
+ * drawing it. Any search already running is cancelled first.
+ *
+ * @param engine The engine.
+ * @param model The game model.
+ * @param timeBudget The time budget in seconds.
+ */
+void startBestMoveSearch(AIEngine &engine, GameModel &model, double timeBudget);
+
+/**
+ * @brief Indicates whether a background search was started and not yet collected.
+ *
+ * @param engine The engine.
+ * @return true or false.
+ */
+bool isBestMoveSearchRunning(AIEngine &engine);
+
+/**
+ * @brief Polls the background search without blocking.
+ *
+ * @param engine The engine.
+ * @param move Receives the best move once the search has finished.
+ * @return Whether the search finished (the result is collected only once).
+ */
+bool pollBestMoveSearch(AIEngine &engine, Square &move);
+
+/**
+ * @brief Cancels the background search or pondering, if any, and waits for it to stop.
+ *
+ * @param engine The engine.
+ */
+void cancelBestMoveSearch(AIEngine &engine);
+
+/**
+ * @brief Enables or disables pondering (enabled by default).
+ *
+ * @param engine The engine.
+ * @param enabled Whether startPondering should search.
+ */
+void setPondering(AIEngine &engine, bool enabled);
+
+/**
+ * @brief Starts pondering on a background thread during the human's turn.
+ *
+ * Searches the AI's best answer to every human reply, deepening them one
+ * ply at a time, and keeps the transposition table warm. When the next
+ * search starts from a pondered reply, it continues from the depth already
+ * reached, or answers at once if the reply was solved to the end of the
+ * game or already got the whole time budget. Starting a search cancels
+ * pondering.
+ *
+ * @param engine The engine.
+ * @param model The game model, with the human to move.
+ */
+void startPondering(AIEngine &engine, GameModel &model);
+
+/**
+ * @brief Indicates whether pondering was started and not yet cancelled.
+ *
+ * @param engine The engine.
+ * @return true or false.
+ */
+bool isPondering(AIEngine &engine);
 
 #endif
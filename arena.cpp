@@ -0,0 +1,460 @@
+/**
+ * @brief Headless self-play arena: engine A against engine B
+ *
+ * Plays pairs of games from random or book openings (each opening once with
+ * each color) on all cores, and reports A's win rate with its confidence
+ * interval and the aggregate search speed.
+ *
+ * Usage: arena [--games N] [--concurrency N] [--time S] [--time-a S]
+ *              [--time-b S] [--endgame-a N] [--endgame-b N]
+ *              [--weights-a FILE] [--weights-b FILE] [--book-a FILE]
+ *              [--book-b FILE] [--selectivity-a N] [--selectivity-b N]
+ *              [--probcut-a FILE] [--probcut-b FILE] [--hash MB]
+ *              [--random-plies N] [--openings FILE] [--seed N]
+ *              [--mode-a alphabeta|mcts] [--mode-b alphabeta|mcts]
+ *              [--eval-a patterns|network] [--eval-b patterns|network]
+ *              [--network-a FILE] [--network-b FILE]
+ *
+ * An openings file has one opening per line, as a move list ("f5d6c3").
+ * Each engine uses --hash for its transposition table, or for its tree in
+ * MCTS mode, where the reported nodes are playouts.
+ *
+ * @copyright Copyright (c) 2023-2024
+ */
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ai.h"
+#include "endgame.h"
+#include "probcut.h"
+
+// Valor z del intervalo de confianza del 95%
+#define CONFIDENCE_Z 1.96
+
+struct EngineConfig
+{
+    double moveTime;
+    int endgameEmpties;
+    // Archivo de pesos de la evaluacin, o nullptr para los pesos heursticos
+    const char *weightsPath;
+    // Archivo de la red, o nullptr para la red heurstica
+    const char *networkPath;
+    // Libro de aperturas, o nullptr para jugar sin libro
+    const char *bookPath;
+    int selectivity;
+    // Parmetros de Multi-ProbCut, o nullptr para los incorporados
+    const char *probCutPath;
+    SearchMode mode;
+    EvalMode evalMode;
+};
+
+struct ArenaConfig
+{
+    int games;
+    int concurrency;
+    size_t hashSize;
+    int randomPlies;
+    uint64_t seed;
+    std::vector<Moves> openings;
+    EngineConfig engines[2];
+};
+
+// Totales de la arena, compartidos por los hilos
+struct ArenaResults
+{
+    std::mutex mutex;
+    int wins;
+    int draws;
+    int losses;
+    int discDifference;
+    uint64_t nodes[2];
+    double seconds[2];
+};
+
+static bool parseOpening(const std::string &line, Moves &moves)
+{
+    for (size_t i = 0; i + 1 < line.size(); i += 2)
+    {
+        Square move = {line[i] - (line[i] >= 'a' ? 'a' : 'A'), line[i + 1] - '1'};
+        if (!isSquareValid(move))
+            return false;
+
+        moves.push_back(move);
+    }
+
+    return !moves.empty();
+}
+
+static bool loadOpenings(const char *path, std::vector<Moves> &openings)
+{
+    std::ifstream file(path);
+    if (!file)
+        return false;
+
+    std::string line;
+    while (std::getline(file, line))
+    {
+        Moves moves;
+        if (!line.empty() && (line[0] != '#') && parseOpening(line, moves))
+            openings.push_back(moves);
+    }
+
+    return !openings.empty();
+}
+
+// Juega la apertura del par: del archivo, o jugadas al azar reproducibles
+static bool playOpening(ArenaConfig &config, int pair, GameModel &model)
+{
+    startModel(model);
+
+    if (!config.openings.empty())
+    {
+        for (auto move : config.openings[pair % config.openings.size()])
+            if (model.gameOver || !playMove(model, move))
+                return false;
+
+        return !model.gameOver;
+    }
+
+    std::mt19937_64 random(config.seed + pair);
+    for (int ply = 0; (ply < config.randomPlies) && !model.gameOver; ply++)
+    {
+        Moves validMoves;
+        getValidMoves(model, validMoves);
+        playMove(model, validMoves[random() % validMoves.size()]);
+    }
+
+    return !model.gameOver;
+}
+
+// Juega una partida y suma el resultado de A
+static void playGame(ArenaConfig &config,
+                     ArenaResults &results,
+                     AIEngine *engines[2],
+                     GameModel &model,
+                     Player playerA)
+{
+    uint64_t nodes[2] = {0, 0};
+    double seconds[2] = {0, 0};
+
+    while (!model.gameOver)
+    {
+        int side = (model.currentPlayer == playerA) ? 0 : 1;
+        AIEngine &engine = *engines[side];
+
+        // Con una sola jugada posible no hay bsqueda (ni estadsticas)
+        bool searched = countBits(getValidMovesBitboard(model)) > 1;
+        Square move = getBestMove(engine, model, config.engines[side].moveTime);
+        if (searched)
+        {
+            SearchStats stats = getSearchStats(engine);
+            nodes[side] += stats.nodes;
+            seconds[side] += stats.seconds;
+        }
+
+        playMove(model, move);
+    }
+
+    Player playerB = (playerA == PLAYER_BLACK) ? PLAYER_WHITE : PLAYER_BLACK;
+    int difference = getScore(model, playerA) - getScore(model, playerB);
+
+    std::lock_guard<std::mutex> lock(results.mutex);
+    for (int side = 0; side < 2; side++)
+    {
+        results.nodes[side] += nodes[side];
+        results.seconds[side] += seconds[side];
+    }
+    if (difference > 0)
+        results.wins++;
+    else if (difference < 0)
+        results.losses++;
+    else
+        results.draws++;
+    results.discDifference += difference;
+}
+
+// Cada hilo tiene su par de motores y toma partidas hasta que no quedan
+static void arenaWorker(ArenaConfig &config, ArenaResults &results, std::atomic<int> &nextGame)
+{
+    AIEngine *engines[2];
+    for (int side = 0; side < 2; side++)
+    {
+        engines[side] = createEngine();
+        setHashSize(*engines[side], config.hashSize);
+        setEndgameThreshold(*engines[side], config.engines[side].endgameEmpties);
+        if (config.engines[side].weightsPath)
+            setEvalWeights(*engines[side], config.engines[side].weightsPath);
+        if (config.engines[side].networkPath)
+            setEvalNetwork(*engines[side], config.engines[side].networkPath);
+        if (config.engines[side].bookPath)
+            setOpeningBook(*engines[side], config.engines[side].bookPath);
+        setSelectivity(*engines[side], config.engines[side].selectivity);
+        setSearchMode(*engines[side], config.engines[side].mode);
+        setEvalMode(*engines[side], config.engines[side].evalMode);
+        if (config.engines[side].probCutPath)
+            setProbCutParams(*engines[side], config.engines[side].probCutPath);
+    }
+
+    for (int game = nextGame++; game < config.games; game = nextGame++)
+    {
+        GameModel model;
+        if (!playOpening(config, game / 2, model))
+        {
+            std::lock_guard<std::mutex> lock(results.mutex);
+            std::cerr << "Skipping game " << game << ": invalid opening" << std::endl;
+            continue;
+        }
+
+        // En cada par, A juega una vez con cada color
+        Player playerA = (game % 2) ? PLAYER_WHITE : PLAYER_BLACK;
+        playGame(config, results, engines, model, playerA);
+    }
+
+    for (int side = 0; side < 2; side++)
+        freeEngine(engines[side]);
+}
+
+// Diferencia de Elo equivalente a un puntaje esperado
+static double getEloDifference(double score)
+{
+    if (score <= 0)
+        return -INFINITY;
+    if (score >= 1)
+        return INFINITY;
+
+    return -400 * std::log10(1 / score - 1);
+}
+
+static void printResults(ArenaResults &results, double wallSeconds)
+{
+    int games = results.wins + results.draws + results.losses;
+    if (!games)
+    {
+        std::cout << "No games played" << std::endl;
+        return;
+    }
+
+    // Puntaje por partida: 1, 1/2 o 0; el intervalo usa su varianza muestral
+    double score = (results.wins + 0.5 * results.draws) / games;
+    double variance = (results.wins * std::pow(1 - score, 2) +
+                       results.draws * std::pow(0.5 - score, 2) +
+                       results.losses * std::pow(score, 2)) /
+                      games;
+    double margin = CONFIDENCE_Z * std::sqrt(variance / games);
+
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << "Games: " << games
+              << " (A: +" << results.wins
+              << " =" << results.draws
+              << " -" << results.losses << ")" << std::endl;
+    std::cout << "A score: " << 100 * score << "% +/- " << 100 * margin
+              << "% (95% CI)" << std::endl;
+    std::cout << "Elo difference: " << getEloDifference(score)
+              << " [" << getEloDifference(score - margin)
+              << ", " << getEloDifference(score + margin) << "]" << std::endl;
+    std::cout << "Average disc difference: "
+              << (double)results.discDifference / games << std::endl;
+
+    const char *names[2] = {"A", "B"};
+    uint64_t totalNodes = 0;
+    for (int side = 0; side < 2; side++)
+    {
+        double nodesPerSecond = (results.seconds[side] > 0)
+                                    ? results.nodes[side] / results.seconds[side]
+                                    : 0;
+        std::cout << "Engine " << names[side] << ": " << results.nodes[side]
+                  << " nodes, " << std::setprecision(0) << nodesPerSecond
+                  << " nodes/s" << std::setprecision(1) << std::endl;
+        totalNodes += results.nodes[side];
+    }
+    std::cout << "Aggregate: " << std::setprecision(0) << totalNodes / wallSeconds
+              << " nodes/s over " << std::setprecision(1) << wallSeconds
+              << " s" << std::endl;
+}
+
+int main(int argc, char *argv[])
+{
+    ArenaConfig config;
+    config.games = 100;
+    config.concurrency = (int)std::thread::hardware_concurrency();
+    config.hashSize = 16;
+    config.randomPlies = 8;
+    config.seed = 1;
+    for (int side = 0; side < 2; side++)
+    {
+        config.engines[side].moveTime = 0.1;
+        config.engines[side].endgameEmpties = ENDGAME_DEFAULT_EMPTIES;
+        config.engines[side].weightsPath = nullptr;
+        config.engines[side].networkPath = nullptr;
+        config.engines[side].bookPath = nullptr;
+        config.engines[side].selectivity = PROBCUT_DEFAULT_SELECTIVITY;
+        config.engines[side].probCutPath = nullptr;
+        config.engines[side].mode = SEARCH_ALPHABETA;
+        config.engines[side].evalMode = EVAL_PATTERNS;
+    }
+
+    for (int i = 1; i < argc; i++)
+    {
+        std::string option = argv[i];
+        const char *value = (i + 1 < argc) ? argv[i + 1] : nullptr;
+
+        if (!value)
+        {
+            std::cerr << "Missing value for " << option << std::endl;
+            return 1;
+        }
+        i++;
+
+        if (option == "--games")
+            config.games = std::atoi(value);
+        else if (option == "--concurrency")
+            config.concurrency = std::atoi(value);
+        else if (option == "--time")
+            config.engines[0].moveTime = config.engines[1].moveTime = std::atof(value);
+        else if (option == "--time-a")
+            config.engines[0].moveTime = std::atof(value);
+        else if (option == "--time-b")
+            config.engines[1].moveTime = std::atof(value);
+        else if (option == "--endgame-a")
+            config.engines[0].endgameEmpties = std::atoi(value);
+        else if (option == "--endgame-b")
+            config.engines[1].endgameEmpties = std::atoi(value);
+        else if ((option == "--weights-a") || (option == "--weights-b"))
+        {
+            // Se valida ac, as los hilos no tienen que informar errores
+            AIEngine *engine = createEngine();
+            bool loaded = setEvalWeights(*engine, value);
+            freeEngine(engine);
+            if (!loaded)
+            {
+                std::cerr << "Could not read weights from " << value << std::endl;
+                return 1;
+            }
+
+            config.engines[(option == "--weights-a") ? 0 : 1].weightsPath = value;
+        }
+        else if ((option == "--network-a") || (option == "--network-b"))
+        {
+            AIEngine *engine = createEngine();
+            bool loaded = setEvalNetwork(*engine, value);
+            freeEngine(engine);
+            if (!loaded)
+            {
+                std::cerr << "Could not read network from " << value << std::endl;
+                return 1;
+            }
+
+            config.engines[(option == "--network-a") ? 0 : 1].networkPath = value;
+        }
+        else if ((option == "--book-a") || (option == "--book-b"))
+        {
+            AIEngine *engine = createEngine();
+            bool opened = setOpeningBook(*engine, value);
+            freeEngine(engine);
+            if (!opened)
+            {
+                std::cerr << "Could not open book " << value << std::endl;
+                return 1;
+            }
+
+            config.engines[(option == "--book-a") ? 0 : 1].bookPath = value;
+        }
+        else if (option == "--selectivity-a")
+            config.engines[0].selectivity = std::atoi(value);
+        else if (option == "--selectivity-b")
+            config.engines[1].selectivity = std::atoi(value);
+        else if ((option == "--probcut-a") || (option == "--probcut-b"))
+        {
+            AIEngine *engine = createEngine();
+            bool loaded = setProbCutParams(*engine, value);
+            freeEngine(engine);
+            if (!loaded)
+            {
+                std::cerr << "Could not read ProbCut parameters from " << value << std::endl;
+                return 1;
+            }
+
+            config.engines[(option == "--probcut-a") ? 0 : 1].probCutPath = value;
+        }
+        else if ((option == "--mode-a") || (option == "--mode-b"))
+        {
+            std::string mode = value;
+            if ((mode != "alphabeta") && (mode != "mcts"))
+            {
+                std::cerr << "Unknown mode " << value << std::endl;
+                return 1;
+            }
+
+            config.engines[(option == "--mode-a") ? 0 : 1].mode =
+                (mode == "mcts") ? SEARCH_MCTS : SEARCH_ALPHABETA;
+        }
+        else if ((option == "--eval-a") || (option == "--eval-b"))
+        {
+            std::string eval = value;
+            if ((eval != "patterns") && (eval != "network"))
+            {
+                std::cerr << "Unknown evaluation " << value << std::endl;
+                return 1;
+            }
+
+            config.engines[(option == "--eval-a") ? 0 : 1].evalMode =
+                (eval == "network") ? EVAL_NETWORK : EVAL_PATTERNS;
+        }
+        else if (option == "--hash")
+            config.hashSize = (size_t)std::atoi(value);
+        else if (option == "--random-plies")
+            config.randomPlies = std::atoi(value);
+        else if (option == "--seed")
+            config.seed = std::strtoull(value, nullptr, 10);
+        else if (option == "--openings")
+        {
+            if (!loadOpenings(value, config.openings))
+            {
+                std::cerr << "Could not read openings from " << value << std::endl;
+                return 1;
+            }
+        }
+        else
+        {
+            std::cerr << "Unknown option " << option << std::endl;
+            return 1;
+        }
+    }
+
+    if (config.concurrency < 1)
+        config.concurrency = 1;
+
+    ArenaResults results;
+    results.wins = results.draws = results.losses = 0;
+    results.discDifference = 0;
+    results.nodes[0] = results.nodes[1] = 0;
+    results.seconds[0] = results.seconds[1] = 0;
+
+    std::atomic<int> nextGame(0);
+    auto start = std::chrono::steady_clock::now();
+
+    std::vector<std::thread> workers;
+    for (int i = 0; i < config.concurrency; i++)
+        workers.push_back(std::thread(arenaWorker,
+                                      std::ref(config),
+                                      std::ref(results),
+                                      std::ref(nextGame)));
+    for (auto &worker : workers)
+        worker.join();
+
+    double wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    printResults(results, wallSeconds);
+
+    return 0;
+}
@@ -0,0 +1,420 @@
+/**
+ * @brief Implements batched move generation over many independent boards
+ *
+ * @copyright Copyright (c) 2023-2024
+ */
+
+#include <cstring>
+
+#include "batch.h"
+
+// Las versiones vectoriales se compilan con atributos de destino, sin
+// cambiar las opciones del resto del programa; slo se llaman si la CPU
+// tiene las instrucciones
+#if (defined(__GNUC__) || defined(__clang__)) && defined(__x86_64__)
+#define BATCH_X86
+#define BATCH_TARGET(isa) __attribute__((target(isa)))
+#include <immintrin.h>
+#elif defined(_MSC_VER) && defined(_M_X64)
+#define BATCH_X86
+#define BATCH_TARGET(isa)
+#include <immintrin.h>
+#include <intrin.h>
+#endif
+
+#define BATCH_TARGET_AVX2 BATCH_TARGET("avx2")
+#define BATCH_TARGET_AVX512 BATCH_TARGET("avx512f")
+
+static bool detectBatchBackend(BatchBackend backend)
+{
+    if (backend == BATCH_SCALAR)
+        return true;
+
+#if defined(BATCH_X86) && defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7)
+        return false;
+
+    // El sistema operativo tiene que guardar los registros vectoriales
+    __cpuid(info, 1);
+    if (!(info[2] & (1 << 27)))
+        return false;
+    unsigned long long xcr0 = _xgetbv(0);
+
+    __cpuidex(info, 7, 0);
+    if (backend == BATCH_AVX2)
+        return (info[1] & (1 << 5)) && ((xcr0 & 0x06) == 0x06);
+    return (info[1] & (1 << 16)) && ((xcr0 & 0xe6) == 0xe6);
+#elif defined(BATCH_X86)
+    __builtin_cpu_init();
+    if (backend == BATCH_AVX2)
+        return __builtin_cpu_supports("avx2");
+    return __builtin_cpu_supports("avx512f");
+#else
+    return false;
+#endif
+}
+
+static BatchBackend getFastestBatchBackend()
+{
+    if (detectBatchBackend(BATCH_AVX512))
+        return BATCH_AVX512;
+    if (detectBatchBackend(BATCH_AVX2))
+        return BATCH_AVX2;
+    return BATCH_SCALAR;
+}
+
+static BatchBackend batchBackend = getFastestBatchBackend();
+
+static void getMovesScalar(const uint64_t *player, const uint64_t *opponent, uint64_t *moves, size_t start, size_t count)
+{
+    for (size_t i = start; i < count; i++)
+        moves[i] = getMovesBitboard(player[i], opponent[i]);
+}
+
+static void makeMovesScalar(const uint64_t *player,
+                            const uint64_t *opponent,
+                            const uint8_t *moves,
+                            uint64_t *nextPlayer,
+                            uint64_t *nextOpponent,
+                            size_t start,
+                            size_t count)
+{
+    for (size_t i = start; i < count; i++)
+    {
+        uint64_t flips = getFlipsBitboard(player[i], opponent[i], moves[i]);
+        uint64_t p = player[i];
+        uint64_t o = opponent[i];
+
+        nextPlayer[i] = flips ? (o ^ flips) : p;
+        nextOpponent[i] = flips ? (p | flips | squareBit(moves[i])) : o;
+    }
+}
+
+#if defined(BATCH_X86)
+
+// Corrimiento con el sentido y la distancia fijos al compilar (shift > 0:
+// hacia ndices mayores); las dos ramas llevan inmediatos vlidos
+template <int shift>
+static inline BATCH_TARGET_AVX2 __m256i shift256(__m256i bitboards)
+{
+    return (shift > 0) ? _mm256_slli_epi64(bitboards, (shift > 0) ? shift : 0)
+                       : _mm256_srli_epi64(bitboards, (shift < 0) ? -shift : 0);
+}
+
+// Cadenas de hasta seis fichas de mask propagadas desde from (Kogge-Stone)
+template <int shift>
+static inline BATCH_TARGET_AVX2 __m256i fill256(__m256i from, __m256i mask)
+{
+    __m256i fill = _mm256_and_si256(mask, shift256<shift>(from));
+    fill = _mm256_or_si256(fill, _mm256_and_si256(mask, shift256<shift>(fill)));
+
+    __m256i pre = _mm256_and_si256(mask, shift256<shift>(mask));
+    fill = _mm256_or_si256(fill, _mm256_and_si256(pre, shift256<2 * shift>(fill)));
+    fill = _mm256_or_si256(fill, _mm256_and_si256(pre, shift256<2 * shift>(fill)));
+
+    return fill;
+}
+
+template <int shift>
+static inline BATCH_TARGET_AVX2 __m256i getDirectionMoves256(__m256i player, __m256i mask)
+{
+    return shift256<shift>(fill256<shift>(player, mask));
+}
+
+// Fichas enemigas encerradas desde la jugada: la cadena cuenta slo si la
+// casilla siguiente a su extremo es propia
+template <int shift>
+static inline BATCH_TARGET_AVX2 __m256i getDirectionFlips256(__m256i player, __m256i mask, __m256i move)
+{
+    __m256i line = fill256<shift>(move, mask);
+    __m256i outflank = _mm256_and_si256(player, _mm256_andnot_si256(line, shift256<shift>(line)));
+    __m256i notBounded = _mm256_cmpeq_epi64(outflank, _mm256_setzero_si256());
+
+    return _mm256_andnot_si256(notBounded, line);
+}
+
+static BATCH_TARGET_AVX2 void getMovesAVX2(const uint64_t *player, const uint64_t *opponent, uint64_t *moves, size_t count)
+{
+    const __m256i innerFiles = _mm256_set1_epi64x((long long)MASK_INNER_FILES);
+
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        __m256i p = _mm256_loadu_si256((const __m256i *)(player + i));
+        __m256i o = _mm256_loadu_si256((const __m256i *)(opponent + i));
+        __m256i inner = _mm256_and_si256(o, innerFiles);
+
+        __m256i m = getDirectionMoves256<1>(p, inner);
+        m = _mm256_or_si256(m, getDirectionMoves256<-1>(p, inner));
+        m = _mm256_or_si256(m, getDirectionMoves256<8>(p, o));
+        m = _mm256_or_si256(m, getDirectionMoves256<-8>(p, o));
+        m = _mm256_or_si256(m, getDirectionMoves256<7>(p, inner));
+        m = _mm256_or_si256(m, getDirectionMoves256<-7>(p, inner));
+        m = _mm256_or_si256(m, getDirectionMoves256<9>(p, inner));
+        m = _mm256_or_si256(m, getDirectionMoves256<-9>(p, inner));
+
+        // Slo las casillas vacas
+        m = _mm256_andnot_si256(_mm256_or_si256(p, o), m);
+        _mm256_storeu_si256((__m256i *)(moves + i), m);
+    }
+
+    getMovesScalar(player, opponent, moves, i, count);
+}
+
+static BATCH_TARGET_AVX2 void makeMovesAVX2(const uint64_t *player,
+                                            const uint64_t *opponent,
+                                            const uint8_t *moves,
+                                            uint64_t *nextPlayer,
+                                            uint64_t *nextOpponent,
+                                            size_t count)
+{
+    const __m256i innerFiles = _mm256_set1_epi64x((long long)MASK_INNER_FILES);
+    const __m256i one = _mm256_set1_epi64x(1);
+
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        __m256i p = _mm256_loadu_si256((const __m256i *)(player + i));
+        __m256i o = _mm256_loadu_si256((const __m256i *)(opponent + i));
+        __m256i inner = _mm256_and_si256(o, innerFiles);
+
+        int indices;
+        memcpy(&indices, moves + i, sizeof(indices));
+        __m256i move = _mm256_sllv_epi64(one, _mm256_cvtepu8_epi64(_mm_cvtsi32_si128(indices)));
+
+        __m256i f = getDirectionFlips256<1>(p, inner, move);
+        f = _mm256_or_si256(f, getDirectionFlips256<-1>(p, inner, move));
+        f = _mm256_or_si256(f, getDirectionFlips256<8>(p, o, move));
+        f = _mm256_or_si256(f, getDirectionFlips256<-8>(p, o, move));
+        f = _mm256_or_si256(f, getDirectionFlips256<7>(p, inner, move));
+        f = _mm256_or_si256(f, getDirectionFlips256<-7>(p, inner, move));
+        f = _mm256_or_si256(f, getDirectionFlips256<9>(p, inner, move));
+        f = _mm256_or_si256(f, getDirectionFlips256<-9>(p, inner, move));
+
+        // Una casilla ocupada no da vuelta fichas: queda invlida
+        __m256i empty = _mm256_cmpeq_epi64(_mm256_and_si256(_mm256_or_si256(p, o), move),
+                                           _mm256_setzero_si256());
+        f = _mm256_and_si256(f, empty);
+        __m256i invalid = _mm256_cmpeq_epi64(f, _mm256_setzero_si256());
+
+        __m256i np = _mm256_xor_si256(o, f);
+        __m256i no = _mm256_or_si256(_mm256_or_si256(p, f), move);
+        _mm256_storeu_si256((__m256i *)(nextPlayer + i), _mm256_blendv_epi8(np, p, invalid));
+        _mm256_storeu_si256((__m256i *)(nextOpponent + i), _mm256_blendv_epi8(no, o, invalid));
+    }
+
+    makeMovesScalar(player, opponent, moves, nextPlayer, nextOpponent, i, count);
+}
+
+template <int shift>
+static inline BATCH_TARGET_AVX512 __m512i shift512(__m512i bitboards)
+{
+    return (shift > 0) ? _mm512_slli_epi64(bitboards, (shift > 0) ? shift : 0)
+                       : _mm512_srli_epi64(bitboards, (shift < 0) ? -shift : 0);
+}
+
+template <int shift>
+static inline BATCH_TARGET_AVX512 __m512i fill512(__m512i from, __m512i mask)
+{
+    __m512i fill = _mm512_and_si512(mask, shift512<shift>(from));
+    fill = _mm512_or_si512(fill, _mm512_and_si512(mask, shift512<shift>(fill)));
+
+    __m512i pre = _mm512_and_si512(mask, shift512<shift>(mask));
+    fill = _mm512_or_si512(fill, _mm512_and_si512(pre, shift512<2 * shift>(fill)));
+    fill = _mm512_or_si512(fill, _mm512_and_si512(pre, shift512<2 * shift>(fill)));
+
+    return fill;
+}
+
+template <int shift>
+static inline BATCH_TARGET_AVX512 __m512i getDirectionMoves512(__m512i player, __m512i mask)
+{
+    return shift512<shift>(fill512<shift>(player, mask));
+}
+
+template <int shift>
+static inline BATCH_TARGET_AVX512 __m512i getDirectionFlips512(__m512i player, __m512i mask, __m512i move)
+{
+    __m512i line = fill512<shift>(move, mask);
+    __m512i outflank = _mm512_andnot_si512(line, shift512<shift>(line));
+
+    return _mm512_maskz_mov_epi64(_mm512_test_epi64_mask(player, outflank), line);
+}
+
+static BATCH_TARGET_AVX512 void getMovesAVX512(const uint64_t *player, const uint64_t *opponent, uint64_t *moves, size_t count)
+{
+    const __m512i innerFiles = _mm512_set1_epi64((long long)MASK_INNER_FILES);
+
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        __m512i p = _mm512_loadu_si512((const void *)(player + i));
+        __m512i o = _mm512_loadu_si512((const void *)(opponent + i));
+        __m512i inner = _mm512_and_si512(o, innerFiles);
+
+        __m512i m = getDirectionMoves512<1>(p, inner);
+        m = _mm512_or_si512(m, getDirectionMoves512<-1>(p, inner));
+        m = _mm512_or_si512(m, getDirectionMoves512<8>(p, o));
+        m = _mm512_or_si512(m, getDirectionMoves512<-8>(p, o));
+        m = _mm512_or_si512(m, getDirectionMoves512<7>(p, inner));
+        m = _mm512_or_si512(m, getDirectionMoves512<-7>(p, inner));
+        m = _mm512_or_si512(m, getDirectionMoves512<9>(p, inner));
+        m = _mm512_or_si512(m, getDirectionMoves512<-9>(p, inner));
+
+        m = _mm512_andnot_si512(_mm512_or_si512(p, o), m);
+        _mm512_storeu_si512((void *)(moves + i), m);
+    }
+
+    getMovesScalar(player, opponent, moves, i, count);
+}
+
+static BATCH_TARGET_AVX512 void makeMovesAVX512(const uint64_t *player,
+                                                const uint64_t *opponent,
+                                                const uint8_t *moves,
+                                                uint64_t *nextPlayer,
+                                                uint64_t *nextOpponent,
+                                                size_t count)
+{
+    const __m512i innerFiles = _mm512_set1_epi64((long long)MASK_INNER_FILES);
+    const __m512i one = _mm512_set1_epi64(1);
+
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        __m512i p = _mm512_loadu_si512((const void *)(player + i));
+        __m512i o = _mm512_loadu_si512((const void *)(opponent + i));
+        __m512i inner = _mm512_and_si512(o, innerFiles);
+
+        long long indices;
+        memcpy(&indices, moves + i, sizeof(indices));
+        __m512i move = _mm512_sllv_epi64(one, _mm512_cvtepu8_epi64(_mm_cvtsi64_si128(indices)));
+
+        __m512i f = getDirectionFlips512<1>(p, inner, move);
+        f = _mm512_or_si512(f, getDirectionFlips512<-1>(p, inner, move));
+        f = _mm512_or_si512(f, getDirectionFlips512<8>(p, o, move));
+        f = _mm512_or_si512(f, getDirectionFlips512<-8>(p, o, move));
+        f = _mm512_or_si512(f, getDirectionFlips512<7>(p, inner, move));
+        f = _mm512_or_si512(f, getDirectionFlips512<-7>(p, inner, move));
+        f = _mm512_or_si512(f, getDirectionFlips512<9>(p, inner, move));
+        f = _mm512_or_si512(f, getDirectionFlips512<-9>(p, inner, move));
+
+        // Vlidas: la casilla est vaca y la jugada da vuelta alguna ficha
+        __mmask8 valid = _mm512_test_epi64_mask(f, f) &
+                         _mm512_testn_epi64_mask(_mm512_or_si512(p, o), move);
+
+        __m512i np = _mm512_xor_si512(o, f);
+        __m512i no = _mm512_or_si512(_mm512_or_si512(p, f), move);
+        _mm512_storeu_si512((void *)(nextPlayer + i), _mm512_mask_mov_epi64(p, valid, np));
+        _mm512_storeu_si512((void *)(nextOpponent + i), _mm512_mask_mov_epi64(o, valid, no));
+    }
+
+    makeMovesScalar(player, opponent, moves, nextPlayer, nextOpponent, i, count);
+}
+
+#endif
+
+void addBatchBoard(BoardBatch &boards, GameModel &model)
+{
+    Player opponent = (model.currentPlayer == PLAYER_WHITE) ? PLAYER_BLACK : PLAYER_WHITE;
+
+    boards.player.push_back(model.board[model.currentPlayer]);
+    boards.opponent.push_back(model.board[opponent]);
+}
+
+void getMovesBatch(const BoardBatch &boards, std::vector<uint64_t> &moves)
+{
+    size_t count = boards.player.size();
+    moves.resize(count);
+    if (!count)
+        return;
+
+    const uint64_t *player = boards.player.data();
+    const uint64_t *opponent = boards.opponent.data();
+
+    switch (batchBackend)
+    {
+#if defined(BATCH_X86)
+    case BATCH_AVX512:
+        getMovesAVX512(player, opponent, moves.data(), count);
+        break;
+
+    case BATCH_AVX2:
+        getMovesAVX2(player, opponent, moves.data(), count);
+        break;
+#endif
+
+    default:
+        getMovesScalar(player, opponent, moves.data(), 0, count);
+        break;
+    }
+}
+
+void makeMovesBatch(const BoardBatch &boards,
+                    const std::vector<uint8_t> &moves,
+                    BoardBatch &nextBoards)
+{
+    size_t count = boards.player.size();
+    nextBoards.player.resize(count);
+    nextBoards.opponent.resize(count);
+    if (!count)
+        return;
+
+    const uint64_t *player = boards.player.data();
+    const uint64_t *opponent = boards.opponent.data();
+    uint64_t *nextPlayer = nextBoards.player.data();
+    uint64_t *nextOpponent = nextBoards.opponent.data();
+
+    switch (batchBackend)
+    {
+#if defined(BATCH_X86)
+    case BATCH_AVX512:
+        makeMovesAVX512(player, opponent, moves.data(), nextPlayer, nextOpponent, count);
+        break;
+
+    case BATCH_AVX2:
+        makeMovesAVX2(player, opponent, moves.data(), nextPlayer, nextOpponent, count);
+        break;
+#endif
+
+    default:
+        makeMovesScalar(player, opponent, moves.data(), nextPlayer, nextOpponent, 0, count);
+        break;
+    }
+}
+
+BatchBackend getBatchBackend()
+{
+    return batchBackend;
+}
+
+bool setBatchBackend(BatchBackend backend)
+{
+    if (!isBatchBackendSupported(backend))
+        return false;
+
+    batchBackend = backend;
+
+    return true;
+}
+
+bool isBatchBackendSupported(BatchBackend backend)
+{
+    return detectBatchBackend(backend);
+}
+
+const char *getBatchBackendName(BatchBackend backend)
+{
+    switch (backend)
+    {
+    case BATCH_AVX2:
+        return "AVX2";
+
+    case BATCH_AVX512:
+        return "AVX-512";
+
+    default:
+        return "scalar";
+    }
+}
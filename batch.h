@@ -0,0 +1,98 @@
+/**
+ * @brief Implements batched move generation over many independent boards
+ *
+ * Boards are stored as a structure of arrays (all the player bitboards, then
+ * all the opponent bitboards), so vector instructions process 4 (AVX2) or
+ * 8 (AVX-512) boards per instruction with the same shift-and-mask direction
+ * fills as model.cpp. The instruction set is chosen at runtime from the CPU
+ * features, with a scalar fallback on other CPUs and compilers.
+ *
+ * @copyright Copyright (c) 2023-2024
+ */
+
+#ifndef BATCH_H
+#define BATCH_H
+
+#include <cstdint>
+#include <vector>
+
+#include "model.h"
+
+enum BatchBackend
+{
+    BATCH_SCALAR,
+    BATCH_AVX2,
+    BATCH_AVX512,
+};
+
+struct BoardBatch
+{
+    // Board i is player[i] and opponent[i], from the side to move
+    std::vector<uint64_t> player;
+    std::vector<uint64_t> opponent;
+};
+
+/**
+ * @brief Appends a position to a batch, from its side to move.
+ *
+ * @param boards The batch.
+ * @param model The position.
+ */
+void addBatchBoard(BoardBatch &boards, GameModel &model);
+
+/**
+ * @brief Computes the valid moves of every board of a batch.
+ *
+ * @param boards The batch.
+ * @param moves Receives the bitboard of valid moves of each board.
+ */
+void getMovesBatch(const BoardBatch &boards, std::vector<uint64_t> &moves);
+
+/**
+ * @brief Plays one move on every board of a batch.
+ *
+ * The boards after the moves are seen from the side to move next, so the
+ * player and opponent swap. Passes are not made: the caller checks the
+ * valid moves of the new boards.
+ *
+ * @param boards The batch.
+ * @param moves The bit index of the move of each board (0-63). An invalid
+ * move leaves its board unchanged, without swapping sides.
+ * @param nextBoards Receives the boards after the moves (it may not be boards).
+ */
+void makeMovesBatch(const BoardBatch &boards,
+                    const std::vector<uint8_t> &moves,
+                    BoardBatch &nextBoards);
+
+/**
+ * @brief Returns the backend used by the batch functions.
+ *
+ * @return The fastest backend of the CPU, unless another was set.
+ */
+BatchBackend getBatchBackend();
+
+/**
+ * @brief Selects the backend of the batch functions (for benchmarks).
+ *
+ * @param backend The backend.
+ * @return Whether the CPU supports it (the backend is unchanged otherwise).
+ */
+bool setBatchBackend(BatchBackend backend);
+
+/**
+ * @brief Indicates whether the CPU supports a backend.
+ *
+ * @param backend The backend.
+ * @return true or false.
+ */
+bool isBatchBackendSupported(BatchBackend backend);
+
+/**
+ * @brief Returns the name of a backend.
+ *
+ * @param backend The backend.
+ * @return "scalar", "AVX2" or "AVX-512".
+ */
+const char *getBatchBackendName(BatchBackend backend);
+
+#endif
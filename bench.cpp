@@ -0,0 +1,315 @@
+/**
+ * @brief Micro-benchmarks for the functions of the game model
+ *
+ * Runs each function of model.cpp over a fixed set of positions taken from
+ * seeded random games, and prints the time per call. The batch functions of
+ * batch.cpp run over the same positions with every backend the CPU
+ * supports, and print the throughput in positions per second. The pattern
+ * evaluation and the neural network evaluation (with each backend) run over
+ * them too, with their incremental updates, and print the evaluations per
+ * second as calls per second.
+ *
+ * Usage: bench [--positions N] [--seconds S]
+ *
+ * @copyright Copyright (c) 2023-2024
+ */
+
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "batch.h"
+#include "eval.h"
+#include "model.h"
+#include "nnue.h"
+
+// Un caso de prueba: la posicin, una jugada vlida en ella y el estado de
+// las evaluaciones (calculado slo para sus pruebas)
+struct BenchPosition
+{
+    GameModel model;
+    Square move;
+    EvalState eval;
+    NnueAccumulator accumulator;
+};
+
+// Evita que el compilador descarte los resultados
+static volatile uint64_t benchSink;
+
+static void generatePositions(std::vector<BenchPosition> &positions, int count)
+{
+    std::mt19937_64 random(1);
+
+    while ((int)positions.size() < count)
+    {
+        GameModel model;
+        startModel(model);
+
+        while (!model.gameOver && ((int)positions.size() < count))
+        {
+            Moves validMoves;
+            getValidMoves(model, validMoves);
+
+            BenchPosition position;
+            position.model = model;
+            position.move = validMoves[random() % validMoves.size()];
+            positions.push_back(position);
+
+            playMove(model, position.move);
+        }
+    }
+}
+
+// Repite la funcin sobre todas las posiciones hasta cubrir el tiempo pedido
+template <typename Function>
+static void runBenchmark(const char *name,
+                         std::vector<BenchPosition> &positions,
+                         double minSeconds,
+                         Function function)
+{
+    typedef std::chrono::steady_clock Clock;
+
+    uint64_t calls = 0;
+    uint64_t sum = 0;
+    double seconds = 0;
+    auto start = Clock::now();
+
+    while (seconds < minSeconds)
+    {
+        for (auto &position : positions)
+            sum += function(position);
+
+        calls += positions.size();
+        seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    }
+    benchSink = sum;
+
+    std::cout << std::left << std::setw(32) << name << std::right
+              << std::fixed << std::setprecision(2) << std::setw(10)
+              << 1e9 * seconds / calls << " ns/call "
+              << std::setprecision(0) << std::setw(14) << calls / seconds
+              << " calls/s" << std::endl;
+}
+
+// Repite la funcin por lotes sobre todas las posiciones hasta cubrir el tiempo pedido
+template <typename Function>
+static void runBatchBenchmark(const char *name,
+                              BatchBackend backend,
+                              size_t positionCount,
+                              double minSeconds,
+                              Function function)
+{
+    typedef std::chrono::steady_clock Clock;
+
+    std::string label = std::string(name) + " (" + getBatchBackendName(backend) + ")";
+
+    uint64_t positions = 0;
+    uint64_t sum = 0;
+    double seconds = 0;
+    auto start = Clock::now();
+
+    while (seconds < minSeconds)
+    {
+        sum += function();
+
+        positions += positionCount;
+        seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    }
+    benchSink = sum;
+
+    std::cout << std::left << std::setw(32) << label << std::right
+              << std::fixed << std::setprecision(2) << std::setw(10)
+              << 1e9 * seconds / positions << " ns/position "
+              << std::setprecision(0) << std::setw(14) << positions / seconds
+              << " positions/s" << std::endl;
+}
+
+static void runBatchBenchmarks(std::vector<BenchPosition> &positions, double minSeconds)
+{
+    BoardBatch boards;
+    std::vector<uint8_t> moves;
+    for (auto &position : positions)
+    {
+        addBatchBoard(boards, position.model);
+        moves.push_back((uint8_t)getSquareIndex(position.move));
+    }
+
+    std::vector<uint64_t> validMoves;
+    BoardBatch nextBoards;
+    BatchBackend defaultBackend = getBatchBackend();
+
+    for (int backend = BATCH_SCALAR; backend <= BATCH_AVX512; backend++)
+    {
+        if (!setBatchBackend((BatchBackend)backend))
+            continue;
+
+        runBatchBenchmark("getMovesBatch", (BatchBackend)backend, positions.size(), minSeconds, [&]() {
+            getMovesBatch(boards, validMoves);
+            return validMoves[0];
+        });
+        runBatchBenchmark("makeMovesBatch", (BatchBackend)backend, positions.size(), minSeconds, [&]() {
+            makeMovesBatch(boards, moves, nextBoards);
+            return nextBoards.player[0];
+        });
+    }
+
+    setBatchBackend(defaultBackend);
+}
+
+static void runEvalBenchmarks(std::vector<BenchPosition> &positions, double minSeconds)
+{
+    static EvalWeights weights;
+    static NnueWeights network;
+    initEvalWeights(weights);
+    initNnueWeights(network);
+
+    for (auto &position : positions)
+    {
+        initEvalState(position.eval, position.model);
+        initNnueAccumulator(position.accumulator, network, position.model);
+    }
+
+    runBenchmark("evaluatePosition", positions, minSeconds, [](BenchPosition &position) {
+        return (uint64_t)evaluatePosition(weights, position.eval, position.model);
+    });
+    runBenchmark("updateEvalState + restore", positions, minSeconds, [](BenchPosition &position) {
+        GameModel &model = position.model;
+        int index = getSquareIndex(position.move);
+        uint64_t flips = getFlipsBitboard(model.board[model.currentPlayer],
+                                          model.board[1 - model.currentPlayer],
+                                          index);
+        updateEvalState(position.eval, model.currentPlayer, index, flips);
+        restoreEvalState(position.eval, model.currentPlayer, index, flips);
+        return (uint64_t)position.eval.indices[0];
+    });
+
+    BatchBackend defaultBackend = getNnueBackend();
+
+    for (int backend = BATCH_SCALAR; backend <= BATCH_AVX2; backend++)
+    {
+        if (!setNnueBackend((BatchBackend)backend))
+            continue;
+
+        std::string suffix = std::string(" (") + getBatchBackendName((BatchBackend)backend) + ")";
+
+        runBenchmark(("evaluateNnue" + suffix).c_str(), positions, minSeconds, [](BenchPosition &position) {
+            return (uint64_t)evaluateNnue(network, position.accumulator, position.model);
+        });
+        runBenchmark(("updateNnue + restore" + suffix).c_str(), positions, minSeconds, [](BenchPosition &position) {
+            GameModel &model = position.model;
+            int index = getSquareIndex(position.move);
+            uint64_t flips = getFlipsBitboard(model.board[model.currentPlayer],
+                                              model.board[1 - model.currentPlayer],
+                                              index);
+            updateNnueAccumulator(position.accumulator, network, model.currentPlayer, index, flips);
+            restoreNnueAccumulator(position.accumulator, network, model.currentPlayer, index, flips);
+            return (uint64_t)position.accumulator.values[0][0];
+        });
+    }
+
+    setNnueBackend(defaultBackend);
+}
+
+int main(int argc, char *argv[])
+{
+    int positionCount = 10000;
+    double minSeconds = 0.5;
+
+    for (int i = 1; i < argc; i++)
+    {
+        std::string option = argv[i];
+
+        if ((option == "--positions") && (i + 1 < argc))
+            positionCount = std::atoi(argv[++i]);
+        else if ((option == "--seconds") && (i + 1 < argc))
+            minSeconds = std::atof(argv[++i]);
+        else
+        {
+            std::cerr << "Usage: bench [--positions N] [--seconds S]" << std::endl;
+            return 1;
+        }
+    }
+
+    std::vector<BenchPosition> positions;
+    generatePositions(positions, positionCount);
+
+    runBenchmark("initModel", positions, minSeconds, [](BenchPosition &position) {
+        GameModel model;
+        initModel(model);
+        return model.board[PLAYER_BLACK];
+    });
+    runBenchmark("startModel", positions, minSeconds, [](BenchPosition &position) {
+        GameModel model;
+        startModel(model);
+        return model.board[PLAYER_WHITE];
+    });
+    runBenchmark("getCurrentPlayer", positions, minSeconds, [](BenchPosition &position) {
+        return (uint64_t)getCurrentPlayer(position.model);
+    });
+    runBenchmark("getScore", positions, minSeconds, [](BenchPosition &position) {
+        return (uint64_t)getScore(position.model, PLAYER_BLACK);
+    });
+    runBenchmark("getTimer", positions, minSeconds, [](BenchPosition &position) {
+        return (uint64_t)getTimer(position.model, position.model.currentPlayer);
+    });
+    runBenchmark("getBoardPiece", positions, minSeconds, [](BenchPosition &position) {
+        return (uint64_t)getBoardPiece(position.model, position.move);
+    });
+    runBenchmark("setBoardPiece", positions, minSeconds, [](BenchPosition &position) {
+        GameModel model = position.model;
+        setBoardPiece(model, position.move, PIECE_BLACK);
+        return model.hash;
+    });
+    runBenchmark("isSquareValid", positions, minSeconds, [](BenchPosition &position) {
+        return (uint64_t)isSquareValid(position.move);
+    });
+    runBenchmark("getValidMoves", positions, minSeconds, [](BenchPosition &position) {
+        Moves validMoves;
+        getValidMoves(position.model, validMoves);
+        return (uint64_t)validMoves.size();
+    });
+    runBenchmark("getValidMovesBitboard", positions, minSeconds, [](BenchPosition &position) {
+        return getValidMovesBitboard(position.model);
+    });
+    runBenchmark("getMovesBitboard", positions, minSeconds, [](BenchPosition &position) {
+        GameModel &model = position.model;
+        return getMovesBitboard(model.board[model.currentPlayer],
+                                model.board[1 - model.currentPlayer]);
+    });
+    runBenchmark("getFlipsBitboard", positions, minSeconds, [](BenchPosition &position) {
+        GameModel &model = position.model;
+        return getFlipsBitboard(model.board[model.currentPlayer],
+                                model.board[1 - model.currentPlayer],
+                                getSquareIndex(position.move));
+    });
+    runBenchmark("getMoveHashKey", positions, minSeconds, [](BenchPosition &position) {
+        return getMoveHashKey(position.model.currentPlayer,
+                              getSquareIndex(position.move),
+                              position.model.board[PLAYER_BLACK]);
+    });
+    runBenchmark("makeMove + unmakeMove", positions, minSeconds, [](BenchPosition &position) {
+        int index = getSquareIndex(position.move);
+        uint64_t flips = makeMove(position.model, index);
+        unmakeMove(position.model, index, flips);
+        return flips;
+    });
+    runBenchmark("makePass (twice)", positions, minSeconds, [](BenchPosition &position) {
+        makePass(position.model);
+        makePass(position.model);
+        return position.model.hash;
+    });
+    runBenchmark("playMove", positions, minSeconds, [](BenchPosition &position) {
+        GameModel model = position.model;
+        playMove(model, position.move);
+        return model.hash;
+    });
+
+    runBatchBenchmarks(positions, minSeconds);
+    runEvalBenchmarks(positions, minSeconds);
+
+    return 0;
+}
@@ -0,0 +1,147 @@
+/**
+ * @brief Bitboard helpers for the Reversi game model
+ *
+ * @copyright Copyright (c) 2023-2024
+ */
+
+#ifndef BITBOARD_H
+#define BITBOARD_H
+
+#include <cstdint>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+// Excludes the edge files, so horizontal and diagonal shifts do not wrap
+// around to the next row
+#define MASK_INNER_FILES 0x7e7e7e7e7e7e7e7eULL
+
+/**
+ * @brief Returns a bitboard with a single bit set.
+ *
+ * @param index The bit index (0-63).
+ * @return The bitboard.
+ */
+constexpr uint64_t squareBit(int index)
+{
+    return (uint64_t)1 << index;
+}
+
+/**
+ * @brief Returns a mask of the lowest bits of a bitboard.
+ *
+ * @param bits The number of bits (0-64).
+ * @return The mask.
+ */
+constexpr uint64_t getLowBitsMask(int bits)
+{
+    return (bits >= 64) ? ~0ULL : (((uint64_t)1 << bits) - 1);
+}
+
+/**
+ * @brief Returns the mask of a file (column) of a square board.
+ *
+ * @param size The board size.
+ * @param file The file (0 to size - 1).
+ * @param row The first row to include (all of them by default).
+ * @return The mask.
+ */
+constexpr uint64_t getFileMask(int size, int file, int row = 0)
+{
+    return (row >= size)
+               ? 0
+               : (squareBit(row * size + file) | getFileMask(size, file, row + 1));
+}
+
+/**
+ * @brief Masks and direction shifts of a Size x Size board, whose square
+ * {x, y} is bit (y * Size + x) of a bitboard. Computed at compile time.
+ */
+template <int Size>
+struct BoardGeometry
+{
+    static_assert((Size >= 4) && (Size <= 8) && !(Size % 2),
+                  "Reversi boards are even, from 4x4 to 8x8");
+
+    static constexpr int squares = Size * Size;
+
+    // All the squares of the board
+    static constexpr uint64_t boardMask = getLowBitsMask(Size * Size);
+
+    // Excludes the edge files, so horizontal and diagonal shifts do not wrap
+    // around to the next row
+    static constexpr uint64_t innerFilesMask =
+        getLowBitsMask(Size * Size) & ~getFileMask(Size, 0) & ~getFileMask(Size, Size - 1);
+
+    // Shifts of one square along each direction (and its opposite)
+    static constexpr int horizontalShift = 1;
+    static constexpr int verticalShift = Size;
+    static constexpr int diagonalShift = Size + 1;
+    static constexpr int antidiagonalShift = Size - 1;
+};
+
+template <int Size>
+constexpr int BoardGeometry<Size>::squares;
+template <int Size>
+constexpr uint64_t BoardGeometry<Size>::boardMask;
+template <int Size>
+constexpr uint64_t BoardGeometry<Size>::innerFilesMask;
+template <int Size>
+constexpr int BoardGeometry<Size>::horizontalShift;
+template <int Size>
+constexpr int BoardGeometry<Size>::verticalShift;
+template <int Size>
+constexpr int BoardGeometry<Size>::diagonalShift;
+template <int Size>
+constexpr int BoardGeometry<Size>::antidiagonalShift;
+
+static_assert(BoardGeometry<8>::innerFilesMask == MASK_INNER_FILES,
+              "MASK_INNER_FILES is the inner files of the 8x8 board");
+
+/**
+ * @brief Counts the set bits of a bitboard.
+ *
+ * @param bitboard The bitboard.
+ * @return The number of set bits.
+ */
+inline int countBits(uint64_t bitboard)
+{
+#if defined(_MSC_VER) && defined(_M_X64)
+    return (int)__popcnt64(bitboard);
+#elif defined(__GNUC__) || defined(__clang__)
+    return __builtin_popcountll(bitboard);
+#else
+    int count = 0;
+    for (; bitboard; bitboard &= bitboard - 1)
+        count++;
+    return count;
+#endif
+}
+
+/**
+ * @brief Returns the index of the lowest set bit of a non-empty bitboard.
+ *
+ * @param bitboard The bitboard (must not be zero).
+ * @return The bit index (0-63).
+ */
+inline int firstBit(uint64_t bitboard)
+{
+#if defined(_MSC_VER) && defined(_M_X64)
+    unsigned long index;
+    _BitScanForward64(&index, bitboard);
+    return (int)index;
+#elif defined(__GNUC__) || defined(__clang__)
+    return __builtin_ctzll(bitboard);
+#else
+    int index = 0;
+    while (!(bitboard & 1))
+    {
+        bitboard >>= 1;
+        index++;
+    }
+    return index;
+#endif
+}
+
+#endif
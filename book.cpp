@@ -0,0 +1,172 @@
+/**
+ * @brief Implements the Reversi opening book
+ *
+ * @copyright Copyright (c) 2023-2024
+ */
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "book.h"
+#include "symmetry.h"
+
+bool openBook(OpeningBook &book, const char *path)
+{
+    book.entries = nullptr;
+    book.count = 0;
+    book.mapping = nullptr;
+    book.mappingSize = 0;
+
+#if defined(_WIN32)
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE)
+        return false;
+
+    LARGE_INTEGER size;
+    HANDLE mapping = NULL;
+    if (GetFileSizeEx(file, &size) && size.QuadPart)
+        mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    CloseHandle(file);
+    if (!mapping)
+        return false;
+
+    // La vista sigue vlida despus de cerrar los handles
+    book.mapping = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    CloseHandle(mapping);
+    if (!book.mapping)
+        return false;
+    book.mappingSize = (size_t)size.QuadPart;
+#else
+    int file = open(path, O_RDONLY);
+    if (file < 0)
+        return false;
+
+    struct stat status;
+    void *mapping = MAP_FAILED;
+    if (!fstat(file, &status) && status.st_size)
+        mapping = mmap(nullptr, (size_t)status.st_size, PROT_READ, MAP_SHARED, file, 0);
+    close(file);
+    if (mapping == MAP_FAILED)
+        return false;
+
+    book.mapping = mapping;
+    book.mappingSize = (size_t)status.st_size;
+#endif
+
+    // Slo se verifica el encabezado: las entradas se leen en el lugar
+    const BookHeader *header = (const BookHeader *)book.mapping;
+    if ((book.mappingSize < sizeof(BookHeader)) ||
+        memcmp(header->magic, BOOK_FILE_MAGIC, 4) ||
+        (header->version != BOOK_FILE_VERSION) ||
+        (book.mappingSize != sizeof(BookHeader) + header->count * sizeof(BookEntry)))
+    {
+        closeBook(book);
+        return false;
+    }
+
+    book.entries = (const BookEntry *)(header + 1);
+    book.count = (size_t)header->count;
+
+    return true;
+}
+
+void closeBook(OpeningBook &book)
+{
+    if (book.mapping)
+    {
+#if defined(_WIN32)
+        UnmapViewOfFile(book.mapping);
+#else
+        munmap(book.mapping, book.mappingSize);
+#endif
+    }
+
+    book.entries = nullptr;
+    book.count = 0;
+    book.mapping = nullptr;
+    book.mappingSize = 0;
+}
+
+bool isBookEntryLess(const BookEntry &a, const BookEntry &b)
+{
+    return (a.player < b.player) || ((a.player == b.player) && (a.opponent < b.opponent));
+}
+
+BookEntry getBookEntry(GameModel &model, Square move, int score, int depth)
+{
+    Player opponent = (model.currentPlayer == PLAYER_WHITE) ? PLAYER_BLACK : PLAYER_WHITE;
+
+    BookEntry entry = BookEntry();
+    entry.player = model.board[model.currentPlayer];
+    entry.opponent = model.board[opponent];
+
+    int symmetry = canonicalizePosition(entry.player, entry.opponent);
+    entry.move = (uint8_t)transformIndex(getSquareIndex(move), symmetry);
+    entry.score = (int8_t)score;
+    entry.depth = (uint8_t)depth;
+
+    return entry;
+}
+
+bool getBookEntryMove(const BookEntry &entry, GameModel &model, Square &move)
+{
+    Player opponent = (model.currentPlayer == PLAYER_WHITE) ? PLAYER_BLACK : PLAYER_WHITE;
+    uint64_t player = model.board[model.currentPlayer];
+    uint64_t other = model.board[opponent];
+    int symmetry = canonicalizePosition(player, other);
+
+    // La jugada vuelve de la forma cannica a la orientacin de la posicin
+    int index = transformIndex(entry.move, getInverseSymmetry(symmetry));
+    if (!(getValidMovesBitboard(model) & squareBit(index)))
+        return false;
+
+    move = getIndexSquare(index);
+
+    return true;
+}
+
+bool probeBook(OpeningBook &book, GameModel &model, Square &move, int &score)
+{
+    if (!book.count)
+        return false;
+
+    BookEntry key = getBookEntry(model, {0, 0}, 0, 0);
+
+    const BookEntry *end = book.entries + book.count;
+    const BookEntry *entry = std::lower_bound(book.entries, end, key, isBookEntryLess);
+    if ((entry == end) || (entry->player != key.player) || (entry->opponent != key.opponent))
+        return false;
+
+    if (!getBookEntryMove(*entry, model, move))
+        return false;
+    score = entry->score;
+
+    return true;
+}
+
+bool saveBook(std::vector<BookEntry> &entries, const char *path)
+{
+    std::ofstream file(path, std::ios::binary);
+    if (!file)
+        return false;
+
+    BookHeader header;
+    memcpy(header.magic, BOOK_FILE_MAGIC, 4);
+    header.version = BOOK_FILE_VERSION;
+    header.count = entries.size();
+
+    file.write((const char *)&header, sizeof(header));
+    file.write((const char *)entries.data(), entries.size() * sizeof(BookEntry));
+
+    return (bool)file;
+}
@@ -0,0 +1,119 @@
+/**
+ * @brief Implements the Reversi opening book
+ *
+ * The book is a binary file: a header followed by entries sorted by
+ * position. Positions are stored from the side to move (player and
+ * opponent discs) and canonicalized to the smallest of their 8 board
+ * symmetries, so transposed and mirrored openings share one entry. The file
+ * is memory-mapped and searched in place, without parsing or copying.
+ *
+ * @copyright Copyright (c) 2023-2024
+ */
+
+#ifndef BOOK_H
+#define BOOK_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "model.h"
+
+#define BOOK_FILE_MAGIC "BOOK"
+#define BOOK_FILE_VERSION 1
+
+struct BookHeader
+{
+    char magic[4];
+    uint32_t version;
+    uint64_t count;
+};
+
+struct BookEntry
+{
+    uint64_t player;
+    uint64_t opponent;
+    // Best move, as a bit index of the canonical position
+    uint8_t move;
+    // Score of the move (final disc difference for the side to move)
+    int8_t score;
+    // Search depth of the score
+    uint8_t depth;
+    uint8_t reserved[5];
+};
+
+struct OpeningBook
+{
+    const BookEntry *entries;
+    size_t count;
+
+    // Mapping of the whole file
+    void *mapping;
+    size_t mappingSize;
+};
+
+/**
+ * @brief Memory-maps a book file.
+ *
+ * @param book The book (closed if the file is missing or invalid).
+ * @param path The file path.
+ * @return Whether the book was opened.
+ */
+bool openBook(OpeningBook &book, const char *path);
+
+/**
+ * @brief Unmaps a book (does nothing if it is not open).
+ *
+ * @param book The book.
+ */
+void closeBook(OpeningBook &book);
+
+/**
+ * @brief Looks up a position in the book.
+ *
+ * @param book The book.
+ * @param model The position.
+ * @param move Receives the book move, in the orientation of the position.
+ * @param score Receives the book score.
+ * @return Whether the position is in the book with a valid move.
+ */
+bool probeBook(OpeningBook &book, GameModel &model, Square &move, int &score);
+
+/**
+ * @brief Converts a position to its book entry.
+ *
+ * @param model The position.
+ * @param move The best move.
+ * @param score The score of the move.
+ * @param depth The search depth of the score.
+ * @return The entry, canonicalized.
+ */
+BookEntry getBookEntry(GameModel &model, Square move, int score, int depth);
+
+/**
+ * @brief Returns the move of an entry in the orientation of a position.
+ *
+ * @param entry The entry of the position.
+ * @param model The position.
+ * @param move Receives the move.
+ * @return Whether the move is valid in the position.
+ */
+bool getBookEntryMove(const BookEntry &entry, GameModel &model, Square &move);
+
+/**
+ * @brief Compares the positions of two entries (the order of the file).
+ *
+ * @return Whether a goes before b.
+ */
+bool isBookEntryLess(const BookEntry &a, const BookEntry &b);
+
+/**
+ * @brief Writes a book file.
+ *
+ * @param entries The entries, sorted and without repeated positions.
+ * @param path The file path.
+ * @return Whether the file was written.
+ */
+bool saveBook(std::vector<BookEntry> &entries, const char *path);
+
+#endif
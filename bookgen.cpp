@@ -0,0 +1,239 @@
+/**
+ * @brief Builds or extends an opening book from searched positions
+ *
+ * Searches every position of self-play games (the first plies of each game,
+ * varied with random moves) and of the given opening lines, and writes the
+ * best move and score of each position to the book. An existing book is
+ * extended: its positions are kept, and only new positions are searched.
+ *
+ * Usage: bookgen --book FILE [--games N] [--plies N] [--random P]
+ *                [--lines FILE] [--time S] [--threads N] [--hash MB]
+ *                [--seed N]
+ *
+ * A lines file has one opening per line, as a move list ("f5d6c3").
+ *
+ * @copyright Copyright (c) 2023-2024
+ */
+
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "ai.h"
+#include "book.h"
+
+typedef std::pair<uint64_t, uint64_t> BookKey;
+typedef std::map<BookKey, BookEntry> BookMap;
+
+struct BookgenConfig
+{
+    const char *bookPath;
+    int games;
+    int plies;
+    double randomRate;
+    const char *linesPath;
+    double moveTime;
+    int threads;
+    size_t hashSize;
+    uint64_t seed;
+};
+
+static void loadEntries(const char *path, BookMap &entries)
+{
+    OpeningBook book = OpeningBook();
+    if (!openBook(book, path))
+        return;
+
+    for (size_t i = 0; i < book.count; i++)
+        entries[BookKey(book.entries[i].player, book.entries[i].opponent)] = book.entries[i];
+
+    closeBook(book);
+}
+
+// Devuelve la jugada del libro, buscando la posicin si todava no est
+static Square addPosition(BookgenConfig &config,
+                          AIEngine &engine,
+                          GameModel &model,
+                          BookMap &entries,
+                          int &searched)
+{
+    BookEntry key = getBookEntry(model, {0, 0}, 0, 0);
+    auto found = entries.find(BookKey(key.player, key.opponent));
+
+    Square move;
+    if ((found != entries.end()) && getBookEntryMove(found->second, model, move))
+        return move;
+
+    // Las jugadas forzadas no necesitan libro (ni se buscan)
+    uint64_t validMoves = getValidMovesBitboard(model);
+    if (countBits(validMoves) == 1)
+        return getIndexSquare(firstBit(validMoves));
+
+    move = getBestMove(engine, model, config.moveTime);
+
+    SearchStats stats = getSearchStats(engine);
+    BookEntry entry = getBookEntry(model, move, stats.score, stats.depth);
+    entries[BookKey(entry.player, entry.opponent)] = entry;
+    searched++;
+
+    return move;
+}
+
+static void playSelfPlayGames(BookgenConfig &config, AIEngine &engine, BookMap &entries)
+{
+    std::mt19937_64 random(config.seed);
+    std::uniform_real_distribution<double> uniform(0, 1);
+
+    for (int game = 0; game < config.games; game++)
+    {
+        GameModel model;
+        startModel(model);
+
+        int searched = 0;
+        for (int ply = 0; (ply < config.plies) && !model.gameOver; ply++)
+        {
+            Square move = addPosition(config, engine, model, entries, searched);
+
+            // Una jugada al azar de vez en cuando, para variar las partidas
+            if (uniform(random) < config.randomRate)
+            {
+                Moves validMoves;
+                getValidMoves(model, validMoves);
+                move = validMoves[random() % validMoves.size()];
+            }
+
+            playMove(model, move);
+        }
+
+        std::cout << "Game " << game + 1 << "/" << config.games << ": "
+                  << searched << " new positions, " << entries.size() << " total" << std::endl;
+    }
+}
+
+static bool addLines(BookgenConfig &config, AIEngine &engine, BookMap &entries)
+{
+    std::ifstream file(config.linesPath);
+    if (!file)
+        return false;
+
+    std::string line;
+    while (std::getline(file, line))
+    {
+        if (line.empty() || (line[0] == '#'))
+            continue;
+
+        GameModel model;
+        startModel(model);
+
+        int searched = 0;
+        for (size_t i = 0; (i + 1 < line.size()) && !model.gameOver; i += 2)
+        {
+            addPosition(config, engine, model, entries, searched);
+
+            if (!playMove(model, {line[i] - 'a', line[i + 1] - '1'}))
+            {
+                std::cerr << "Invalid move in line " << line << std::endl;
+                break;
+            }
+        }
+
+        std::cout << "Line " << line << ": " << searched << " new positions" << std::endl;
+    }
+
+    return true;
+}
+
+int main(int argc, char *argv[])
+{
+    BookgenConfig config;
+    config.bookPath = nullptr;
+    config.games = 0;
+    config.plies = 12;
+    config.randomRate = 0.1;
+    config.linesPath = nullptr;
+    config.moveTime = 1;
+    config.threads = 1;
+    config.hashSize = 64;
+    config.seed = 1;
+
+    for (int i = 1; i < argc; i++)
+    {
+        std::string option = argv[i];
+        const char *value = (i + 1 < argc) ? argv[++i] : nullptr;
+
+        if (!value)
+        {
+            std::cerr << "Missing value for " << option << std::endl;
+            return 1;
+        }
+
+        if (option == "--book")
+            config.bookPath = value;
+        else if (option == "--games")
+            config.games = std::atoi(value);
+        else if (option == "--plies")
+            config.plies = std::atoi(value);
+        else if (option == "--random")
+            config.randomRate = std::atof(value);
+        else if (option == "--lines")
+            config.linesPath = value;
+        else if (option == "--time")
+            config.moveTime = std::atof(value);
+        else if (option == "--threads")
+            config.threads = std::atoi(value);
+        else if (option == "--hash")
+            config.hashSize = (size_t)std::atoi(value);
+        else if (option == "--seed")
+            config.seed = std::strtoull(value, nullptr, 10);
+        else
+        {
+            std::cerr << "Unknown option " << option << std::endl;
+            return 1;
+        }
+    }
+
+    if (!config.bookPath)
+    {
+        std::cerr << "Missing --book FILE" << std::endl;
+        return 1;
+    }
+
+    BookMap entries;
+    loadEntries(config.bookPath, entries);
+    std::cout << "Loaded " << entries.size() << " positions" << std::endl;
+
+    // El motor busca sin libro: cada posicin nueva se busca de verdad
+    AIEngine *engine = createEngine();
+    setSearchThreads(*engine, config.threads);
+    setHashSize(*engine, config.hashSize);
+
+    bool linesRead = !config.linesPath || addLines(config, *engine, entries);
+    playSelfPlayGames(config, *engine, entries);
+
+    freeEngine(engine);
+
+    if (!linesRead)
+    {
+        std::cerr << "Could not read lines from " << config.linesPath << std::endl;
+        return 1;
+    }
+
+    // El mapa ya est ordenado como el archivo
+    std::vector<BookEntry> sorted;
+    for (auto &entry : entries)
+        sorted.push_back(entry.second);
+
+    if (!saveBook(sorted, config.bookPath))
+    {
+        std::cerr << "Could not write " << config.bookPath << std::endl;
+        return 1;
+    }
+    std::cout << "Wrote " << sorted.size() << " positions to " << config.bookPath << std::endl;
+
+    return 0;
+}
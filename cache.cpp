@@ -0,0 +1,313 @@
+/**
+ * @brief Implements the persistent Reversi position cache
+ *
+ * @copyright Copyright (c) 2023-2024
+ */
+
+#include <cstring>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "cache.h"
+#include "symmetry.h"
+
+// Empaquetado de una entrada en 64 bits, como en la tabla de transposicin
+// pero sin edad (el archivo sobrevive a las bsquedas):
+// puntaje (16) | profundidad (8) | cota (8) | mejor jugada (8)
+#define DATA_EMPTY 0
+
+static inline uint64_t packEntry(int score, int depth, Bound bound, int bestMove)
+{
+    return (uint64_t)(uint16_t)score |
+           ((uint64_t)(uint8_t)(depth + 1) << 16) |
+           ((uint64_t)bound << 24) |
+           ((uint64_t)(uint8_t)bestMove << 32);
+}
+
+// La profundidad se guarda desplazada en uno: cero indica una entrada vaca
+static inline int getDataDepth(uint64_t data)
+{
+    return (int)((data >> 16) & 0xff) - 1;
+}
+
+static inline int getDataMove(uint64_t data)
+{
+    return (int)((data >> 32) & 0xff);
+}
+
+// Clave de la posicin cannica. No se usa el hash Zobrist del modelo, que
+// cambia con la simetra y con el color del jugador que mueve
+static inline uint64_t getCacheKey(uint64_t player, uint64_t opponent)
+{
+    uint64_t key = player * 0x9e3779b97f4a7c15ULL ^ ((opponent << 32) | (opponent >> 32));
+
+    key ^= key >> 31;
+    key *= 0xbf58476d1ce4e5b9ULL;
+    key ^= key >> 27;
+    key *= 0x94d049bb133111ebULL;
+    key ^= key >> 31;
+
+    return key;
+}
+
+// Lleva la posicin a su forma cannica; devuelve la simetra aplicada
+static inline int getCanonicalKey(GameModel &model, uint64_t &key)
+{
+    Player opponent = (model.currentPlayer == PLAYER_WHITE) ? PLAYER_BLACK : PLAYER_WHITE;
+    uint64_t player = model.board[model.currentPlayer];
+    uint64_t other = model.board[opponent];
+
+    int symmetry = canonicalizePosition(player, other);
+    key = getCacheKey(player, other);
+
+    return symmetry;
+}
+
+// Es un archivo de cach de otra versin o de otra evaluacin? Sus valores
+// no sirven. Un archivo que no es de cach no se toca
+static bool isStaleHeader(const CacheHeader &header, uint64_t fingerprint)
+{
+    return !memcmp(header.magic, CACHE_FILE_MAGIC, 4) &&
+           ((header.version != CACHE_FILE_VERSION) || (header.fingerprint != fingerprint));
+}
+
+bool openPositionCache(PositionCache &cache, const char *path, size_t megabytes, uint64_t fingerprint)
+{
+    cache.buckets = nullptr;
+    cache.bucketMask = 0;
+    cache.mapping = nullptr;
+    cache.mappingSize = 0;
+
+    // Cantidad de buckets de un archivo nuevo: la mayor potencia de dos que
+    // entra en el tamao pedido
+    uint64_t bucketCount = 1;
+    while (bucketCount * 2 * sizeof(TTBucket) <= megabytes * 1024 * 1024)
+        bucketCount *= 2;
+    size_t newSize = (size_t)((bucketCount + 1) * sizeof(TTBucket));
+
+#if defined(_WIN32)
+    HANDLE file = CreateFileA(path,
+                              GENERIC_READ | GENERIC_WRITE,
+                              FILE_SHARE_READ | FILE_SHARE_WRITE,
+                              NULL,
+                              OPEN_ALWAYS,
+                              FILE_ATTRIBUTE_NORMAL,
+                              NULL);
+    if (file == INVALID_HANDLE_VALUE)
+        return false;
+
+    LARGE_INTEGER size;
+    HANDLE mapping = NULL;
+    bool created = false;
+    if (GetFileSizeEx(file, &size))
+    {
+        // Un archivo viejo se vaca y se vuelve a crear
+        CacheHeader header;
+        DWORD bytesRead = 0;
+        LARGE_INTEGER start = {};
+        if (size.QuadPart &&
+            ReadFile(file, &header, sizeof(header), &bytesRead, NULL) &&
+            (bytesRead == sizeof(header)) &&
+            isStaleHeader(header, fingerprint) &&
+            SetFilePointerEx(file, start, NULL, FILE_BEGIN) &&
+            SetEndOfFile(file))
+            size.QuadPart = 0;
+
+        // Un archivo vaco se extiende al tamao pedido al crear la proyeccin
+        created = !size.QuadPart;
+        if (created)
+            size.QuadPart = (LONGLONG)newSize;
+        mapping = CreateFileMappingA(file, NULL, PAGE_READWRITE, size.HighPart, size.LowPart, NULL);
+    }
+    CloseHandle(file);
+    if (!mapping)
+        return false;
+
+    // La vista sigue vlida despus de cerrar los handles
+    cache.mapping = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, 0);
+    CloseHandle(mapping);
+    if (!cache.mapping)
+        return false;
+    cache.mappingSize = (size_t)size.QuadPart;
+
+    // Windows no garantiza que la extensin del archivo est en cero
+    if (created)
+        memset(cache.mapping, 0, cache.mappingSize);
+#else
+    int file = open(path, O_RDWR | O_CREAT, 0644);
+    if (file < 0)
+        return false;
+
+    // Un archivo vaco se extiende al tamao pedido: queda disperso y en cero,
+    // que es una tabla vaca
+    struct stat status;
+    bool created = false;
+    void *mapping = MAP_FAILED;
+    if (!fstat(file, &status))
+    {
+        // Un archivo viejo se vaca y se vuelve a crear
+        CacheHeader header;
+        if (status.st_size &&
+            (pread(file, &header, sizeof(header), 0) == (ssize_t)sizeof(header)) &&
+            isStaleHeader(header, fingerprint) &&
+            !ftruncate(file, 0))
+            status.st_size = 0;
+
+        created = !status.st_size;
+        if (created && !ftruncate(file, (off_t)newSize))
+            status.st_size = (off_t)newSize;
+        if (status.st_size)
+            mapping = mmap(nullptr, (size_t)status.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, file, 0);
+    }
+    close(file);
+    if (mapping == MAP_FAILED)
+        return false;
+
+    cache.mapping = mapping;
+    cache.mappingSize = (size_t)status.st_size;
+#endif
+
+    CacheHeader *header = (CacheHeader *)cache.mapping;
+    if (created)
+    {
+        memcpy(header->magic, CACHE_FILE_MAGIC, 4);
+        header->version = CACHE_FILE_VERSION;
+        header->bucketCount = bucketCount;
+        header->fingerprint = fingerprint;
+    }
+
+    // Slo se verifica el encabezado: los buckets se leen en el lugar
+    if ((cache.mappingSize < sizeof(CacheHeader)) ||
+        memcmp(header->magic, CACHE_FILE_MAGIC, 4) ||
+        (header->version != CACHE_FILE_VERSION) ||
+        (header->fingerprint != fingerprint) ||
+        !header->bucketCount ||
+        (header->bucketCount & (header->bucketCount - 1)) ||
+        (cache.mappingSize != (header->bucketCount + 1) * sizeof(TTBucket)))
+    {
+        closePositionCache(cache);
+        return false;
+    }
+
+    cache.buckets = (TTBucket *)(header + 1);
+    cache.bucketMask = header->bucketCount - 1;
+
+    return true;
+}
+
+void closePositionCache(PositionCache &cache)
+{
+    if (cache.mapping)
+    {
+#if defined(_WIN32)
+        UnmapViewOfFile(cache.mapping);
+#else
+        munmap(cache.mapping, cache.mappingSize);
+#endif
+    }
+
+    cache.buckets = nullptr;
+    cache.bucketMask = 0;
+    cache.mapping = nullptr;
+    cache.mappingSize = 0;
+}
+
+void flushPositionCache(PositionCache &cache)
+{
+    if (!cache.mapping)
+        return;
+
+#if defined(_WIN32)
+    FlushViewOfFile(cache.mapping, 0);
+#else
+    msync(cache.mapping, cache.mappingSize, MS_ASYNC);
+#endif
+}
+
+bool probePositionCache(PositionCache &cache, GameModel &model, TTEntry &entry)
+{
+    uint64_t key;
+    int symmetry = getCanonicalKey(model, key);
+    TTBucket &bucket = cache.buckets[key & cache.bucketMask];
+
+    for (auto &slot : bucket.slots)
+    {
+        uint64_t data = slot.data.load(std::memory_order_relaxed);
+        uint64_t check = slot.check.load(std::memory_order_relaxed);
+
+        if (((check ^ data) == key) && (data != DATA_EMPTY))
+        {
+            entry.score = (int16_t)(data & 0xffff);
+            entry.depth = getDataDepth(data);
+            entry.bound = (Bound)((data >> 24) & 0xff);
+            entry.bestMove = getDataMove(data);
+
+            // La jugada se guarda en la orientacin cannica
+            if (entry.bestMove != TT_NO_MOVE)
+                entry.bestMove = transformIndex(entry.bestMove, getInverseSymmetry(symmetry));
+
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void storePositionCache(PositionCache &cache,
+                        GameModel &model,
+                        int depth,
+                        Bound bound,
+                        int score,
+                        int bestMove)
+{
+    uint64_t key;
+    int symmetry = getCanonicalKey(model, key);
+    TTBucket &bucket = cache.buckets[key & cache.bucketMask];
+    TTSlot *replace = nullptr;
+    int replaceDepth = 0;
+
+    if (bestMove != TT_NO_MOVE)
+        bestMove = transformIndex(bestMove, symmetry);
+
+    for (auto &slot : bucket.slots)
+    {
+        uint64_t data = slot.data.load(std::memory_order_relaxed);
+        uint64_t check = slot.check.load(std::memory_order_relaxed);
+        int dataDepth = getDataDepth(data);
+
+        if (((check ^ data) == key) && (data != DATA_EMPTY))
+        {
+            if (dataDepth > depth)
+                return;
+
+            // Conserva la mejor jugada conocida si la nueva bsqueda no tiene
+            if (bestMove == TT_NO_MOVE)
+                bestMove = getDataMove(data);
+
+            replace = &slot;
+            replaceDepth = dataDepth;
+            break;
+        }
+
+        if (!replace || (dataDepth < replaceDepth))
+        {
+            replace = &slot;
+            replaceDepth = dataDepth;
+        }
+    }
+
+    // Los resultados profundos de otras posiciones no se pierden
+    if (replaceDepth > depth)
+        return;
+
+    uint64_t data = packEntry(score, depth, bound, bestMove);
+    replace->data.store(data, std::memory_order_relaxed);
+    replace->check.store(key ^ data, std::memory_order_relaxed);
+}
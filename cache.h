@@ -0,0 +1,123 @@
+/**
+ * @brief Implements the persistent Reversi position cache
+ *
+ * The cache is a transposition table kept in a file, so deep search results
+ * survive the end of a game and the restart of the program. The file is a
+ * header followed by buckets of lock-free slots, like the transposition
+ * table's; it is memory-mapped, so opening it reads nothing and each bucket
+ * is loaded by the system when a search first touches it. Results are
+ * written to the mapping and reach the disk in the background.
+ *
+ * Positions are stored from the side to move and canonicalized to the
+ * smallest of their 8 board symmetries (see symmetry.h), so mirrored and
+ * transposed positions share one entry. Scores depend on the evaluation and
+ * on the selectivity of the search, so the header holds a fingerprint of
+ * them: a file written with others (or another version of the format) is
+ * emptied when opened. Processes that share a file at the same time must
+ * search the same way.
+ *
+ * @copyright Copyright (c) 2023-2024
+ */
+
+#ifndef CACHE_H
+#define CACHE_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include "model.h"
+#include "transposition.h"
+
+#define CACHE_FILE_MAGIC "PCCH"
+#define CACHE_FILE_VERSION 2
+
+#define CACHE_DEFAULT_SIZE_MB 256
+
+// The header fills one bucket, so the buckets stay aligned to cache lines
+struct CacheHeader
+{
+    char magic[4];
+    uint32_t version;
+    uint64_t bucketCount;
+    // Identifies the evaluation that produced the scores
+    uint64_t fingerprint;
+    uint8_t reserved[sizeof(TTBucket) - 24];
+};
+
+struct PositionCache
+{
+    TTBucket *buckets;
+    uint64_t bucketMask;
+
+    // Mapping of the whole file
+    void *mapping;
+    size_t mappingSize;
+};
+
+/**
+ * @brief Memory-maps a cache file, creating it if it is missing.
+ *
+ * A new file is created sparse, so it only takes disk space as it fills.
+ * An existing file keeps its own size, unless it has another version or
+ * fingerprint: then it is emptied and created again.
+ *
+ * @param cache The cache (closed if the file can not be opened or is invalid).
+ * @param path The file path.
+ * @param megabytes The size of a new file, rounded down to a power of two of buckets.
+ * @param fingerprint Identifies the evaluation and selectivity of the scores.
+ * @return Whether the cache was opened.
+ */
+bool openPositionCache(PositionCache &cache, const char *path, size_t megabytes, uint64_t fingerprint);
+
+/**
+ * @brief Unmaps a cache (does nothing if it is not open).
+ *
+ * The system still writes any pending results to the file.
+ *
+ * @param cache The cache.
+ */
+void closePositionCache(PositionCache &cache);
+
+/**
+ * @brief Starts writing the changed results of a cache to its file,
+ * without waiting for the writes to finish.
+ *
+ * @param cache The cache.
+ */
+void flushPositionCache(PositionCache &cache);
+
+/**
+ * @brief Looks up a position. Safe to call from several threads (and
+ * processes) at once.
+ *
+ * @param cache The cache.
+ * @param model The position.
+ * @param entry Receives the entry if found, with the best move in the
+ * orientation of the position.
+ * @return Whether the position was found.
+ */
+bool probePositionCache(PositionCache &cache, GameModel &model, TTEntry &entry);
+
+/**
+ * @brief Stores a search result. Safe to call from several threads (and
+ * processes) at once.
+ *
+ * Results never replace deeper ones: the entry of the same position is
+ * replaced if the new search is at least as deep, otherwise the shallowest
+ * entry of the bucket if it is not deeper than the new search.
+ *
+ * @param cache The cache.
+ * @param model The position.
+ * @param depth The searched depth.
+ * @param bound The bound type of the score.
+ * @param score The score.
+ * @param bestMove The bit index of the best move, or TT_NO_MOVE.
+ */
+void storePositionCache(PositionCache &cache,
+                        GameModel &model,
+                        int depth,
+                        Bound bound,
+                        int score,
+                        int bestMove);
+
+#endif
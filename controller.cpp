@@ -10,26 +10,73 @@
 #include "raylib.h"
 
 #include "ai.h"
+#include "cache.h"
 #include "view.h"
 #include "controller.h"
 
+// Pesos de la evaluacin; si el archivo no est se usan los heursticos
+#define EVAL_WEIGHTS_FILE "eval.bin"
+
+// Parmetros de Multi-ProbCut; si el archivo no est se usan los incorporados
+#define PROBCUT_PARAMS_FILE "probcut.bin"
+
+// Libro de aperturas; si el archivo no est se busca desde la primera jugada
+#define OPENING_BOOK_FILE "book.bin"
+
+// Cach persistente de posiciones; se crea si no est
+#define POSITION_CACHE_FILE "cache.bin"
+
+// Registro de las estadsticas de cada jugada de la IA (JSON Lines)
+#define SEARCH_LOG_FILE "search.jsonl"
+
+// Motor de la IA: se crea con la primera actualizacin y se libera al cerrar
+static AIEngine *engine = nullptr;
+
+// Estadsticas de la ltima jugada de la IA; la tecla S las muestra u oculta
+static SearchStats lastStats;
+static bool showStats = false;
+
+// Posicin que se est analizando durante el turno del humano
+static uint64_t ponderedHash = 0;
+
 bool updateView(GameModel &model)
 {
+    if (!engine)
+    {
+        engine = createEngine();
+        setEvalWeights(*engine, EVAL_WEIGHTS_FILE);
+        setProbCutParams(*engine, PROBCUT_PARAMS_FILE);
+        setOpeningBook(*engine, OPENING_BOOK_FILE);
+        setPositionCache(*engine, POSITION_CACHE_FILE, CACHE_DEFAULT_SIZE_MB);
+        setSearchLog(*engine, SEARCH_LOG_FILE);
+    }
+
     if (WindowShouldClose())
+    {
+        freeEngine(engine);
+        engine = nullptr;
+
         return false;
+    }
 
     if (model.gameOver)
     {
+        // La partida termin: el anlisis del turno del humano ya no sirve
+        if (isPondering(*engine))
+            cancelBestMoveSearch(*engine);
+
         if (IsMouseButtonPressed(0))
         {
             if (isMousePointerOverPlayBlackButton())
             {
+                cancelBestMoveSearch(*engine);
                 model.humanPlayer = PLAYER_BLACK;
 
                 startModel(model);
             }
             else if (isMousePointerOverPlayWhiteButton())
             {
+                cancelBestMoveSearch(*engine);
                 model.humanPlayer = PLAYER_WHITE;
 
                 startModel(model);
@@ -38,6 +85,14 @@ bool updateView(GameModel &model)
     }
     else if (model.currentPlayer == model.humanPlayer)
     {
+        // Ponders the human's replies while waiting for the move; if the AI
+        // had to pass, the human moves again from a new position
+        if (!isPondering(*engine) || (ponderedHash != model.hash))
+        {
+            startPondering(*engine, model);
+            ponderedHash = model.hash;
+        }
+
         if (IsMouseButtonPressed(0))
         {
             // Human player
@@ -60,18 +115,28 @@ bool updateView(GameModel &model)
     }
     else
     {
-        // AI player
-        Square square = getBestMove(model);
+        // AI player: searches in the background while the view keeps drawing
+        Square square;
 
-        playMove(model, square);
+        if (!isBestMoveSearchRunning(*engine))
+            startBestMoveSearch(*engine, model, getTimeBudget(model));
+        else if (pollBestMoveSearch(*engine, square))
+        {
+            // La bsqueda ya termin: las estadsticas se leen sin carrera
+            lastStats = getSearchStats(*engine);
+            playMove(model, square);
+        }
     }
 
+    if (IsKeyPressed(KEY_S))
+        showStats = !showStats;
+
     if ((IsKeyDown(KEY_LEFT_ALT) ||
          IsKeyDown(KEY_RIGHT_ALT)) &&
         IsKeyPressed(KEY_ENTER))
         ToggleFullscreen();
 
-    drawView(model);
+    drawView(model, showStats ? &lastStats : nullptr);
 
     return true;
 }
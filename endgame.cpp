@@ -0,0 +1,485 @@
+/**
+ * @brief Implements the Reversi exact endgame solver
+ *
+ * @copyright Copyright (c) 2023-2024
+ */
+
+#include "endgame.h"
+
+// Cota de los valores posibles (diferencia de fichas)
+#define SCORE_INFINITY (BOARD_SIZE * BOARD_SIZE + 1)
+
+// Desde cuntas casillas vacas se ordena por movilidad del oponente (ms
+// cerca del final alcanza con la paridad)
+#define FASTEST_FIRST_EMPTIES 7
+
+// Desde cuntas casillas vacas se usa la tabla de transposicin
+#define TABLE_EMPTIES 10
+
+#define ABORT_CHECK_NODES 4096
+
+#define MAX_ENDGAME_MOVES (BOARD_SIZE * BOARD_SIZE)
+
+// Cuadrante de una casilla (las mitades del tablero en cada eje), como bit
+// de la mscara de paridad
+constexpr uint8_t getSquareQuadrant(int size, int index)
+{
+    return (uint8_t)(1 << (((index % size) >= size / 2) + 2 * ((index / size) >= size / 2)));
+}
+
+constexpr uint64_t getQuadrantMask(int size, int quadrant, int index = 0)
+{
+    return (index >= size * size)
+               ? 0
+               : (((getSquareQuadrant(size, index) == (1 << quadrant)) ? squareBit(index) : 0) |
+                  getQuadrantMask(size, quadrant, index + 1));
+}
+
+// Lista de ndices 0..Count-1, para armar tablas en tiempo de compilacin
+template <int... Indices>
+struct IndexList
+{
+};
+
+template <int Count, int... Indices>
+struct MakeIndexList : MakeIndexList<Count - 1, Count - 1, Indices...>
+{
+};
+
+template <int... Indices>
+struct MakeIndexList<0, Indices...>
+{
+    typedef IndexList<Indices...> type;
+};
+
+// Cuadrante de cada casilla y casillas de cada cuadrante de un tablero
+template <int Size, typename List = typename MakeIndexList<Size * Size>::type>
+struct QuadrantTable;
+
+template <int Size, int... Indices>
+struct QuadrantTable<Size, IndexList<Indices...>>
+{
+    static constexpr uint8_t squares[Size * Size] = {getSquareQuadrant(Size, Indices)...};
+    static constexpr uint64_t masks[4] = {
+        getQuadrantMask(Size, 0),
+        getQuadrantMask(Size, 1),
+        getQuadrantMask(Size, 2),
+        getQuadrantMask(Size, 3),
+    };
+};
+
+template <int Size, int... Indices>
+constexpr uint8_t QuadrantTable<Size, IndexList<Indices...>>::squares[Size * Size];
+template <int Size, int... Indices>
+constexpr uint64_t QuadrantTable<Size, IndexList<Indices...>>::masks[4];
+
+static_assert(QuadrantTable<8>::masks[3] == 0xf0f0f0f000000000ULL,
+              "The quadrants of the 8x8 board are its 4x4 corners");
+
+// Paridad: bit encendido si el cuadrante tiene una cantidad impar de vacas
+template <int Size>
+static int getParity(uint64_t empty)
+{
+    int parity = 0;
+    for (int i = 0; i < 4; i++)
+        if (countBits(empty & QuadrantTable<Size>::masks[i]) & 1)
+            parity |= 1 << i;
+
+    return parity;
+}
+
+static inline int getFinalScore(uint64_t player, uint64_t opponent)
+{
+    return countBits(player) - countBits(opponent);
+}
+
+static inline bool checkAborted(EndgameSearch &search)
+{
+    if (!search.aborted && ((++search.nodes % ABORT_CHECK_NODES) == 0) && search.isAborted)
+        search.aborted = search.isAborted(search.context);
+
+    return search.aborted;
+}
+
+// ltima casilla vaca: si el jugador no puede jugarla pasa, y si el
+// oponente tampoco puede, el juego termin
+template <int Size>
+static int solveLast1(EndgameSearch &search, uint64_t player, uint64_t opponent, int index)
+{
+    search.nodes++;
+
+    int score = getFinalScore(player, opponent);
+
+    uint64_t flips = getFlipsBitboard<Size>(player, opponent, index);
+    if (flips)
+        return score + 2 * countBits(flips) + 1;
+
+    flips = getFlipsBitboard<Size>(opponent, player, index);
+    if (flips)
+        return score - 2 * countBits(flips) - 1;
+
+    return score;
+}
+
+template <int Size>
+static int solveLast2(EndgameSearch &search,
+                      uint64_t player,
+                      uint64_t opponent,
+                      int alpha,
+                      int beta,
+                      int index1,
+                      int index2)
+{
+    search.nodes++;
+
+    int bestValue = -SCORE_INFINITY;
+
+    uint64_t flips = getFlipsBitboard<Size>(player, opponent, index1);
+    if (flips)
+    {
+        bestValue = -solveLast1<Size>(search,
+                                opponent & ~flips,
+                                player | flips | squareBit(index1),
+                                index2);
+        if (bestValue >= beta)
+            return bestValue;
+    }
+
+    flips = getFlipsBitboard<Size>(player, opponent, index2);
+    if (flips)
+    {
+        int value = -solveLast1<Size>(search,
+                                opponent & ~flips,
+                                player | flips | squareBit(index2),
+                                index1);
+        if (value > bestValue)
+            bestValue = value;
+    }
+
+    // Pasada: si el oponente tampoco puede jugar, el juego termin
+    if (bestValue == -SCORE_INFINITY)
+    {
+        if (!getFlipsBitboard<Size>(opponent, player, index1) &&
+            !getFlipsBitboard<Size>(opponent, player, index2))
+            return getFinalScore(player, opponent);
+
+        return -solveLast2<Size>(search, opponent, player, -beta, -alpha, index1, index2);
+    }
+
+    return bestValue;
+}
+
+template <int Size>
+static int solveLast3(EndgameSearch &search,
+                      uint64_t player,
+                      uint64_t opponent,
+                      int alpha,
+                      int beta,
+                      int parity)
+{
+    search.nodes++;
+
+    // Las tres vacas, primero las de cuadrantes impares
+    uint64_t empty = ~(player | opponent) & BoardGeometry<Size>::boardMask;
+    int squares[3];
+    int count = 0;
+    for (uint64_t bits = empty; bits; bits &= bits - 1)
+        if (parity & QuadrantTable<Size>::squares[firstBit(bits)])
+            squares[count++] = firstBit(bits);
+    for (uint64_t bits = empty; bits; bits &= bits - 1)
+        if (!(parity & QuadrantTable<Size>::squares[firstBit(bits)]))
+            squares[count++] = firstBit(bits);
+
+    int bestValue = -SCORE_INFINITY;
+    for (int i = 0; i < 3; i++)
+    {
+        int index = squares[i];
+        uint64_t flips = getFlipsBitboard<Size>(player, opponent, index);
+        if (!flips)
+            continue;
+
+        // Las otras dos vacas, en el mismo orden
+        int value = -solveLast2<Size>(search,
+                                opponent & ~flips,
+                                player | flips | squareBit(index),
+                                -beta,
+                                -alpha,
+                                squares[(i == 0) ? 1 : 0],
+                                squares[(i == 2) ? 1 : 2]);
+        if (value > bestValue)
+        {
+            bestValue = value;
+            if (value > alpha)
+                alpha = value;
+            if (alpha >= beta)
+                break;
+        }
+    }
+
+    // Pasada: si el oponente tampoco puede jugar, el juego termin
+    if (bestValue == -SCORE_INFINITY)
+    {
+        if (!(getMovesBitboard<Size>(opponent, player) & empty))
+            return getFinalScore(player, opponent);
+
+        return -solveLast3<Size>(search, opponent, player, -beta, -alpha, parity);
+    }
+
+    return bestValue;
+}
+
+template <int Size>
+static int solveNode(EndgameSearch &search,
+                     uint64_t player,
+                     uint64_t opponent,
+                     Player side,
+                     uint64_t hash,
+                     int alpha,
+                     int beta,
+                     int emptySquares,
+                     int parity)
+{
+    if (checkAborted(search))
+        return 0;
+
+    // ltimas vacas: rutinas especiales, sin generar jugadas
+    uint64_t empty = ~(player | opponent) & BoardGeometry<Size>::boardMask;
+    switch (emptySquares)
+    {
+    case 0:
+        return getFinalScore(player, opponent);
+    case 1:
+        return solveLast1<Size>(search, player, opponent, firstBit(empty));
+    case 2:
+        return solveLast2<Size>(search,
+                          player,
+                          opponent,
+                          alpha,
+                          beta,
+                          firstBit(empty),
+                          firstBit(empty & (empty - 1)));
+    case 3:
+        return solveLast3<Size>(search, player, opponent, alpha, beta, parity);
+    }
+
+    // Pasada: si el oponente tampoco puede jugar, el juego termin
+    uint64_t moves = getMovesBitboard<Size>(player, opponent);
+    if (!moves)
+    {
+        if (!getMovesBitboard<Size>(opponent, player))
+            return getFinalScore(player, opponent);
+
+        return -solveNode<Size>(search,
+                          opponent,
+                          player,
+                          (side == PLAYER_WHITE) ? PLAYER_BLACK : PLAYER_WHITE,
+                          hash ^ getPassHashKey(),
+                          -beta,
+                          -alpha,
+                          emptySquares,
+                          parity);
+    }
+
+    // La posicin ya fue resuelta por otro orden de jugadas?
+    int alphaOrig = alpha;
+    int ttMove = TT_NO_MOVE;
+    bool useTable = (emptySquares >= TABLE_EMPTIES) && search.table;
+    if (useTable)
+    {
+        TTEntry entry;
+        if (probeTranspositionTable(*search.table, hash, entry, search.tableStats))
+        {
+            ttMove = entry.bestMove;
+
+            if (entry.depth >= emptySquares)
+            {
+                if ((entry.bound == BOUND_EXACT) ||
+                    ((entry.bound == BOUND_LOWER) && (entry.score >= beta)) ||
+                    ((entry.bound == BOUND_UPPER) && (entry.score <= alpha)))
+                    return entry.score;
+            }
+        }
+    }
+
+    // Orden: jugada de la tabla, despus menor movilidad del oponente (lejos
+    // del final) y cuadrantes de paridad impar
+    int indices[MAX_ENDGAME_MOVES];
+    uint64_t flipsList[MAX_ENDGAME_MOVES];
+    int scores[MAX_ENDGAME_MOVES];
+    int count = 0;
+    for (; moves; moves &= moves - 1)
+    {
+        int index = firstBit(moves);
+        uint64_t flips = getFlipsBitboard<Size>(player, opponent, index);
+        int score = (parity & QuadrantTable<Size>::squares[index]) ? 1 : 0;
+
+        if (index == ttMove)
+            score = 1 << 20;
+        else if (emptySquares >= FASTEST_FIRST_EMPTIES)
+        {
+            uint64_t replies = getMovesBitboard<Size>(opponent & ~flips,
+                                                player | flips | squareBit(index));
+            score += (MAX_ENDGAME_MOVES - countBits(replies)) * 2;
+        }
+
+        indices[count] = index;
+        flipsList[count] = flips;
+        scores[count] = score;
+        count++;
+    }
+
+    int bestValue = -SCORE_INFINITY;
+    int bestMove = TT_NO_MOVE;
+    for (int i = 0; i < count; i++)
+    {
+        // Seleccin del mejor puntaje restante
+        int best = i;
+        for (int j = i + 1; j < count; j++)
+            if (scores[j] > scores[best])
+                best = j;
+        if (best != i)
+        {
+            int index = indices[i];
+            uint64_t flips = flipsList[i];
+            int score = scores[i];
+            indices[i] = indices[best];
+            flipsList[i] = flipsList[best];
+            scores[i] = scores[best];
+            indices[best] = index;
+            flipsList[best] = flips;
+            scores[best] = score;
+        }
+
+        int index = indices[i];
+        uint64_t flips = flipsList[i];
+
+        int value = -solveNode<Size>(search,
+                               opponent & ~flips,
+                               player | flips | squareBit(index),
+                               (side == PLAYER_WHITE) ? PLAYER_BLACK : PLAYER_WHITE,
+                               hash ^ getMoveHashKey(side, index, flips),
+                               -beta,
+                               -alpha,
+                               emptySquares - 1,
+                               parity ^ QuadrantTable<Size>::squares[index]);
+        if (search.aborted)
+            return 0;
+
+        if (value > bestValue)
+        {
+            bestValue = value;
+            bestMove = index;
+            if (value > alpha)
+                alpha = value;
+            if (alpha >= beta)
+                break;
+        }
+    }
+
+    if (useTable)
+    {
+        Bound bound = (bestValue <= alphaOrig)
+                          ? BOUND_UPPER
+                          : (bestValue >= beta) ? BOUND_LOWER : BOUND_EXACT;
+        storeTranspositionTable(*search.table, hash, emptySquares, bound, bestValue, bestMove);
+    }
+
+    return bestValue;
+}
+
+// Raz con ventana [alpha, beta]: devuelve el valor y la mejor jugada
+template <int Size>
+static int solveRoot(EndgameSearch &search,
+                     BoardModel<Size> &model,
+                     int alpha,
+                     int beta,
+                     Square &bestMove)
+{
+    Player side = getCurrentPlayer(model);
+    Player other = (side == PLAYER_WHITE) ? PLAYER_BLACK : PLAYER_WHITE;
+    uint64_t player = model.board[side];
+    uint64_t opponent = model.board[other];
+    uint64_t empty = ~(player | opponent) & BoardGeometry<Size>::boardMask;
+    int emptySquares = countBits(empty);
+    int parity = getParity<Size>(empty);
+
+    // Orden de la raz: la jugada sugerida primero, despus menor movilidad del oponente
+    int indices[MAX_ENDGAME_MOVES];
+    int scores[MAX_ENDGAME_MOVES];
+    int count = 0;
+    int hint = isSquareValid<Size>(bestMove) ? getSquareIndex<Size>(bestMove) : TT_NO_MOVE;
+    for (uint64_t moves = getMovesBitboard<Size>(player, opponent); moves; moves &= moves - 1)
+    {
+        int index = firstBit(moves);
+        uint64_t flips = getFlipsBitboard<Size>(player, opponent, index);
+        uint64_t replies = getMovesBitboard<Size>(opponent & ~flips, player | flips | squareBit(index));
+
+        indices[count] = index;
+        scores[count] = (index == hint) ? MAX_ENDGAME_MOVES : -countBits(replies);
+        count++;
+    }
+
+    int bestValue = -SCORE_INFINITY;
+    Square rootMove = bestMove;
+    for (int i = 0; i < count; i++)
+    {
+        for (int j = i + 1; j < count; j++)
+            if (scores[j] > scores[i])
+            {
+                int index = indices[i];
+                int score = scores[i];
+                indices[i] = indices[j];
+                scores[i] = scores[j];
+                indices[j] = index;
+                scores[j] = score;
+            }
+
+        int index = indices[i];
+        uint64_t flips = getFlipsBitboard<Size>(player, opponent, index);
+
+        int value = -solveNode<Size>(search,
+                               opponent & ~flips,
+                               player | flips | squareBit(index),
+                               other,
+                               model.hash ^ getMoveHashKey(side, index, flips),
+                               -beta,
+                               -alpha,
+                               emptySquares - 1,
+                               parity ^ QuadrantTable<Size>::squares[index]);
+        if (search.aborted)
+            return 0;
+
+        if (value > bestValue)
+        {
+            bestValue = value;
+            rootMove = getIndexSquare<Size>(index);
+            if (value > alpha)
+                alpha = value;
+            if (alpha >= beta)
+                break;
+        }
+    }
+
+    // Slo una pasada completa cambia la jugada
+    bestMove = rootMove;
+
+    return bestValue;
+}
+
+template <int Size>
+int solveEndgame(EndgameSearch &search, BoardModel<Size> &model, Square &bestMove)
+{
+    // Ganada, perdida o empatada: bsqueda de ventana mnima alrededor de cero
+    int result = solveRoot<Size>(search, model, -1, 1, bestMove);
+    if (search.aborted || (result == 0))
+        return result;
+
+    // Valor exacto, dentro del lado de cero que dej la prueba
+    if (result > 0)
+        return solveRoot<Size>(search, model, 0, SCORE_INFINITY, bestMove);
+    else
+        return solveRoot<Size>(search, model, -SCORE_INFINITY, 0, bestMove);
+}
+
+template int solveEndgame(EndgameSearch &search, BoardModel<6> &model, Square &bestMove);
+template int solveEndgame(EndgameSearch &search, BoardModel<8> &model, Square &bestMove);
@@ -0,0 +1,47 @@
+/**
+ * @brief Implements the Reversi exact endgame solver
+ *
+ * @copyright Copyright (c) 2023-2024
+ */
+
+#ifndef ENDGAME_H
+#define ENDGAME_H
+
+#include <cstdint>
+
+#include "model.h"
+#include "transposition.h"
+
+#define ENDGAME_DEFAULT_EMPTIES 18
+
+struct EndgameSearch
+{
+    TranspositionTable *table;
+    TTStats tableStats;
+
+    uint64_t nodes;
+
+    // Polled every few thousand nodes with the context; returns true to abort the solve
+    bool (*isAborted)(void *context);
+    void *context;
+    bool aborted;
+};
+
+/**
+ * @brief Solves a position exactly and returns its best move.
+ *
+ * First probes win/loss/draw with a null window around zero, then computes
+ * the exact disc difference within the window the probe leaves open.
+ *
+ * Instantiated for the 6x6 and 8x8 boards.
+ *
+ * @param search The solver state (nodes, table and abort callback).
+ * @param model The position.
+ * @param bestMove A move to try first (may be invalid); receives the best move.
+ * @return The final disc difference for the player to move (meaningless if
+ *         search.aborted is set).
+ */
+template <int Size>
+int solveEndgame(EndgameSearch &search, BoardModel<Size> &model, Square &bestMove);
+
+#endif
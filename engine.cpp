@@ -0,0 +1,679 @@
+/**
+ * @brief Text engine: a line protocol over stdin/stdout for headless analysis
+ *
+ * Reads one command per line and answers with lines that start with a
+ * keyword, so a driver program can run the engine through a pipe. Batch
+ * analysis searches its positions on several worker engines at once, while
+ * the rest of the batch is still being read, and writes the results in the
+ * order of the positions.
+ *
+ * Usage: engine [--workers N] [--threads N] [--hash MB] [--selectivity N]
+ *               [--endgame N] [--weights FILE] [--probcut FILE] [--book FILE]
+ *               [--cache FILE] [--mode alphabeta|mcts]
+ *               [--eval patterns|network] [--network FILE]
+ *
+ * Commands:
+ *   position startpos [moves f5d6c3]
+ *   position board <squares> <side> [moves f5d6c3]
+ *       The 64 squares from a1 to h8, row by row: X (or *) black, O white,
+ *       - (or .) empty. The side to move is X or O.
+ *   play <move>
+ *   go [depth N] [time S] [nodes N]
+ *       Streams "info" lines after each iteration, then "bestmove".
+ *       Without limits, searches for GO_DEFAULT_TIME seconds.
+ *   analyse <count> [depth N] [time S] [nodes N]
+ *       Followed by <count> lines with a position each ("startpos ..." or
+ *       "board ..."), answered with one "result <index>" line per position.
+ *   set <option> <value>
+ *       The options of the command line, without the dashes.
+ *   isready
+ *   quit
+ *
+ * Errors are answered with an "error" line. Searches report the move (or
+ * "none" when the game is over), then the depth, selective depth, score
+ * (disc difference for the side to move), nodes, seconds, nodes per second
+ * and principal variation. In MCTS mode, nodes are playouts, the depth is
+ * the depth of the tree, and "go" reports one "info" line at the end.
+ *
+ * The workers share the position cache file (see cache.h), so each result
+ * is available to all of them and to the next runs.
+ *
+ * @copyright Copyright (c) 2023-2024
+ */
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdlib>
+#include <deque>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ai.h"
+#include "cache.h"
+#include "endgame.h"
+#include "probcut.h"
+
+// Tiempo de bsqueda de "go" sin lmites
+#define GO_DEFAULT_TIME 1.0
+
+// Tabla de cada trabajador: con un trabajador por ncleo, la tabla
+// predeterminada de cada motor ocupara demasiada memoria
+#define WORKER_HASH_SIZE_MB 16
+
+struct EngineSettings
+{
+    int workers;
+    int threads;
+    size_t hashSize;
+    int selectivity;
+    int endgameEmpties;
+    SearchMode mode;
+    EvalMode evalMode;
+    // Archivos a cargar, o vacos para los valores incorporados
+    std::string weightsPath;
+    std::string networkPath;
+    std::string probCutPath;
+    std::string bookPath;
+    std::string cachePath;
+};
+
+// Lmites de una bsqueda (0 es sin lmite)
+struct GoLimits
+{
+    int depth;
+    uint64_t nodes;
+    double time;
+};
+
+struct EngineSession
+{
+    EngineSettings settings;
+    GameModel model;
+
+    // Un motor por trabajador; "go" usa el primero. Se crean al usarlos
+    std::vector<AIEngine *> engines;
+};
+
+// Posiciones de un anlisis por lotes, de la lectura a los trabajadores
+struct AnalysisQueue
+{
+    std::mutex mutex;
+    std::condition_variable ready;
+    std::deque<std::pair<int, GameModel>> positions;
+    bool closed;
+
+    GoLimits limits;
+
+    // Resultados que esperan a los anteriores para salir en orden
+    std::mutex outputMutex;
+    std::map<int, std::string> results;
+    int nextResult;
+};
+
+static void writeSquare(std::ostream &stream, Square square)
+{
+    stream << (char)('a' + square.x) << (char)('1' + square.y);
+}
+
+static bool parseSquare(const std::string &text, size_t offset, Square &square)
+{
+    if (offset + 1 >= text.size())
+        return false;
+
+    char file = text[offset];
+    square = {file - ((file >= 'a') ? 'a' : 'A'), text[offset + 1] - '1'};
+
+    return isSquareValid(square);
+}
+
+// Juega una lista de jugadas ("f5d6c3", o separadas por espacios)
+static bool playMoves(std::istringstream &tokens, GameModel &model, std::string &error)
+{
+    std::string token;
+    while (tokens >> token)
+    {
+        for (size_t i = 0; i < token.size(); i += 2)
+        {
+            Square move;
+            if (!parseSquare(token, i, move) || model.gameOver || !playMove(model, move))
+            {
+                error = "illegal move " + token.substr(i, 2);
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+// Arma la posicin de un tablero escrito casilla por casilla. Si el jugador
+// que mueve no tiene jugadas pasa, igual que en playMove
+static bool setBoardPosition(const std::string &squares,
+                             const std::string &side,
+                             GameModel &model,
+                             std::string &error)
+{
+    if (squares.size() != BOARD_SIZE * BOARD_SIZE)
+    {
+        error = "the board needs 64 squares";
+        return false;
+    }
+
+    startModel(model);
+    for (int y = 0; y < BOARD_SIZE; y++)
+        for (int x = 0; x < BOARD_SIZE; x++)
+        {
+            char piece = squares[y * BOARD_SIZE + x];
+            if ((piece == 'X') || (piece == 'x') || (piece == '*'))
+                setBoardPiece(model, {x, y}, PIECE_BLACK);
+            else if ((piece == 'O') || (piece == 'o'))
+                setBoardPiece(model, {x, y}, PIECE_WHITE);
+            else if ((piece == '-') || (piece == '.'))
+                setBoardPiece(model, {x, y}, PIECE_EMPTY);
+            else
+            {
+                error = std::string("invalid square ") + piece;
+                return false;
+            }
+        }
+
+    if ((side == "O") || (side == "o"))
+        makePass(model);
+    else if ((side != "X") && (side != "x") && (side != "*"))
+    {
+        error = "invalid side to move " + side;
+        return false;
+    }
+
+    if (!getValidMovesBitboard(model))
+    {
+        makePass(model);
+
+        if (!getValidMovesBitboard(model))
+            model.gameOver = true;
+    }
+
+    return true;
+}
+
+// Lee una posicin: "startpos" o "board <casillas> <jugador>", con jugadas opcionales
+static bool parsePosition(std::istringstream &tokens, GameModel &model, std::string &error)
+{
+    std::string type;
+    tokens >> type;
+
+    if (type == "startpos")
+        startModel(model);
+    else if (type == "board")
+    {
+        std::string squares, side;
+        tokens >> squares >> side;
+        if (!setBoardPosition(squares, side, model, error))
+            return false;
+    }
+    else
+    {
+        error = "expected startpos or board";
+        return false;
+    }
+
+    std::string keyword;
+    if (!(tokens >> keyword))
+        return true;
+    if (keyword != "moves")
+    {
+        error = "unexpected " + keyword;
+        return false;
+    }
+
+    return playMoves(tokens, model, error);
+}
+
+static bool parseLimits(std::istringstream &tokens, GoLimits &limits, std::string &error)
+{
+    limits = GoLimits();
+
+    std::string name;
+    while (tokens >> name)
+    {
+        std::string value;
+        if (!(tokens >> value))
+        {
+            error = "missing value for " + name;
+            return false;
+        }
+
+        if (name == "depth")
+            limits.depth = std::atoi(value.c_str());
+        else if (name == "nodes")
+            limits.nodes = std::strtoull(value.c_str(), nullptr, 10);
+        else if (name == "time")
+            limits.time = std::atof(value.c_str());
+        else
+        {
+            error = "unknown limit " + name;
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// Aplica los ajustes a un motor; devuelve false si algn archivo no se pudo cargar
+static bool configureEngine(AIEngine &engine, EngineSettings &settings, std::string &error)
+{
+    setSearchThreads(engine, settings.threads);
+    setHashSize(engine, settings.hashSize);
+    setSelectivity(engine, settings.selectivity);
+    setEndgameThreshold(engine, settings.endgameEmpties);
+    setSearchMode(engine, settings.mode);
+    setEvalMode(engine, settings.evalMode);
+    setPondering(engine, false);
+
+    if (!settings.weightsPath.empty() && !setEvalWeights(engine, settings.weightsPath.c_str()))
+    {
+        error = "could not read weights from " + settings.weightsPath;
+        return false;
+    }
+    if (!settings.networkPath.empty() && !setEvalNetwork(engine, settings.networkPath.c_str()))
+    {
+        error = "could not read network from " + settings.networkPath;
+        return false;
+    }
+    if (!settings.probCutPath.empty() && !setProbCutParams(engine, settings.probCutPath.c_str()))
+    {
+        error = "could not read ProbCut parameters from " + settings.probCutPath;
+        return false;
+    }
+    if (!settings.bookPath.empty() && !setOpeningBook(engine, settings.bookPath.c_str()))
+    {
+        error = "could not open book " + settings.bookPath;
+        return false;
+    }
+    if (!settings.cachePath.empty() &&
+        !setPositionCache(engine, settings.cachePath.c_str(), CACHE_DEFAULT_SIZE_MB))
+    {
+        error = "could not open cache " + settings.cachePath;
+        return false;
+    }
+
+    return true;
+}
+
+static void freeEngines(EngineSession &session)
+{
+    for (auto engine : session.engines)
+        freeEngine(engine);
+
+    session.engines.clear();
+}
+
+// Crea los motores que falten para los trabajadores
+static bool prepareEngines(EngineSession &session, std::string &error)
+{
+    while ((int)session.engines.size() < session.settings.workers)
+    {
+        AIEngine *engine = createEngine();
+        session.engines.push_back(engine);
+
+        if (!configureEngine(*engine, session.settings, error))
+        {
+            freeEngines(session);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// Lee un ajuste, sin aplicarlo a los motores
+static bool parseOption(EngineSettings &settings,
+                        const std::string &name,
+                        const std::string &value,
+                        std::string &error)
+{
+    if (name == "workers")
+        settings.workers = std::max(std::atoi(value.c_str()), 1);
+    else if (name == "threads")
+        settings.threads = std::max(std::atoi(value.c_str()), 1);
+    else if (name == "hash")
+        settings.hashSize = (size_t)std::max(std::atoi(value.c_str()), 1);
+    else if (name == "selectivity")
+        settings.selectivity = std::atoi(value.c_str());
+    else if (name == "endgame")
+        settings.endgameEmpties = std::atoi(value.c_str());
+    else if (name == "weights")
+        settings.weightsPath = value;
+    else if (name == "network")
+        settings.networkPath = value;
+    else if (name == "probcut")
+        settings.probCutPath = value;
+    else if (name == "book")
+        settings.bookPath = value;
+    else if (name == "cache")
+        settings.cachePath = value;
+    else if (name == "mode")
+    {
+        if ((value != "alphabeta") && (value != "mcts"))
+        {
+            error = "unknown mode " + value;
+            return false;
+        }
+        settings.mode = (value == "mcts") ? SEARCH_MCTS : SEARCH_ALPHABETA;
+    }
+    else if (name == "eval")
+    {
+        if ((value != "patterns") && (value != "network"))
+        {
+            error = "unknown evaluation " + value;
+            return false;
+        }
+        settings.evalMode = (value == "network") ? EVAL_NETWORK : EVAL_PATTERNS;
+    }
+    else
+    {
+        error = "unknown option " + name;
+        return false;
+    }
+
+    return true;
+}
+
+// Cambia un ajuste durante la sesin; los motores se vuelven a crear con el
+// ajuste nuevo
+static bool setOption(EngineSession &session,
+                      const std::string &name,
+                      const std::string &value,
+                      std::string &error)
+{
+    EngineSettings previous = session.settings;
+
+    if (!parseOption(session.settings, name, value, error))
+    {
+        session.settings = previous;
+        return false;
+    }
+
+    freeEngines(session);
+    if (!prepareEngines(session, error))
+    {
+        session.settings = previous;
+        return false;
+    }
+
+    return true;
+}
+
+static void applyLimits(AIEngine &engine, const GoLimits &limits)
+{
+    setSearchLimits(engine, limits.depth, limits.nodes);
+}
+
+static double getTimeLimit(const GoLimits &limits)
+{
+    if (limits.time > 0)
+        return limits.time;
+
+    return (limits.depth || limits.nodes) ? NO_TIME_LIMIT : GO_DEFAULT_TIME;
+}
+
+// Profundidad, puntaje, nodos, tiempo y variante principal de una bsqueda
+static void writeSearchStats(std::ostream &stream, const SearchStats &stats)
+{
+    stream << "depth " << stats.depth
+           << " seldepth " << stats.selectiveDepth
+           << " score " << stats.score
+           << " nodes " << stats.nodes
+           << " time " << std::fixed << std::setprecision(3) << stats.seconds
+           << " nps " << (uint64_t)stats.nodesPerSecond;
+    if (stats.book)
+        stream << " book";
+    if (stats.cache)
+        stream << " cache";
+
+    stream << " pv ";
+    for (auto move : stats.principalVariation)
+        writeSquare(stream, move);
+}
+
+// Busca una posicin y escribe la jugada con sus estadsticas
+static void writeSearchResult(std::ostream &stream,
+                              AIEngine &engine,
+                              GameModel &model,
+                              const GoLimits &limits)
+{
+    if (model.gameOver)
+    {
+        stream << "none";
+        return;
+    }
+
+    GameModel position = model;
+    Square move = getBestMove(engine, position, getTimeLimit(limits));
+
+    writeSquare(stream, move);
+    stream << " ";
+    writeSearchStats(stream, getSearchStats(engine));
+}
+
+static void writeSearchInfo(void *context, const SearchStats &stats)
+{
+    std::ostringstream line;
+    line << "info ";
+    writeSearchStats(line, stats);
+
+    std::cout << line.str() << std::endl;
+}
+
+static void runGo(EngineSession &session, const GoLimits &limits)
+{
+    AIEngine &engine = *session.engines[0];
+
+    applyLimits(engine, limits);
+    setSearchInfoCallback(engine, writeSearchInfo, nullptr);
+
+    std::ostringstream line;
+    line << "bestmove ";
+    writeSearchResult(line, engine, session.model, limits);
+
+    setSearchInfoCallback(engine, nullptr, nullptr);
+
+    std::cout << line.str() << std::endl;
+}
+
+// Guarda un resultado y escribe todos los que ya pueden salir en orden
+static void addAnalysisResult(AnalysisQueue &queue, int index, const std::string &result)
+{
+    std::lock_guard<std::mutex> lock(queue.outputMutex);
+
+    queue.results[index] = result;
+    for (auto next = queue.results.find(queue.nextResult);
+         next != queue.results.end();
+         next = queue.results.find(queue.nextResult))
+    {
+        std::cout << "result " << next->first << " " << next->second << std::endl;
+        queue.results.erase(next);
+        queue.nextResult++;
+    }
+}
+
+// Cada trabajador busca posiciones de la cola hasta que se cierra y vaca
+static void analysisWorker(AnalysisQueue &queue, AIEngine *engine)
+{
+    applyLimits(*engine, queue.limits);
+
+    while (true)
+    {
+        std::pair<int, GameModel> position;
+        {
+            std::unique_lock<std::mutex> lock(queue.mutex);
+            queue.ready.wait(lock, [&]() { return queue.closed || !queue.positions.empty(); });
+            if (queue.positions.empty())
+                return;
+
+            position = queue.positions.front();
+            queue.positions.pop_front();
+        }
+
+        std::ostringstream result;
+        writeSearchResult(result, *engine, position.second, queue.limits);
+        addAnalysisResult(queue, position.first, result.str());
+    }
+}
+
+// Lee las posiciones del lote mientras los trabajadores ya buscan las primeras
+static void runAnalysis(EngineSession &session, int count, const GoLimits &limits)
+{
+    AnalysisQueue queue;
+    queue.closed = false;
+    queue.limits = limits;
+    queue.nextResult = 0;
+
+    std::vector<std::thread> workers;
+    for (auto engine : session.engines)
+        workers.push_back(std::thread(analysisWorker, std::ref(queue), engine));
+
+    std::string line;
+    for (int index = 0; (index < count) && std::getline(std::cin, line); index++)
+    {
+        std::istringstream tokens(line);
+        GameModel model;
+        std::string error;
+
+        if (!parsePosition(tokens, model, error))
+        {
+            addAnalysisResult(queue, index, "error " + error);
+            continue;
+        }
+
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.positions.push_back(std::make_pair(index, model));
+        queue.ready.notify_one();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.closed = true;
+        queue.ready.notify_all();
+    }
+    for (auto &worker : workers)
+        worker.join();
+}
+
+// Ejecuta un comando; devuelve false para terminar
+static bool runCommand(EngineSession &session, const std::string &line)
+{
+    std::istringstream tokens(line);
+    std::string command;
+    if (!(tokens >> command) || (command[0] == '#'))
+        return true;
+
+    std::string error;
+    if (command == "quit")
+        return false;
+    else if (command == "isready")
+        std::cout << "readyok" << std::endl;
+    else if (command == "position")
+    {
+        GameModel model;
+        if (parsePosition(tokens, model, error))
+            session.model = model;
+    }
+    else if (command == "play")
+    {
+        GameModel model = session.model;
+        if (playMoves(tokens, model, error))
+            session.model = model;
+    }
+    else if (command == "set")
+    {
+        std::string name, value;
+        if (!(tokens >> name >> value))
+            error = "expected set <option> <value>";
+        else
+            setOption(session, name, value, error);
+    }
+    else if ((command == "go") || (command == "analyse"))
+    {
+        int count = 0;
+        if ((command == "analyse") && !(tokens >> count))
+            error = "expected analyse <count>";
+
+        GoLimits limits;
+        if (error.empty() && parseLimits(tokens, limits, error) &&
+            prepareEngines(session, error))
+        {
+            if (command == "go")
+                runGo(session, limits);
+            else
+                runAnalysis(session, count, limits);
+        }
+    }
+    else
+        error = "unknown command " + command;
+
+    if (!error.empty())
+        std::cout << "error " << error << std::endl;
+
+    return true;
+}
+
+int main(int argc, char *argv[])
+{
+    EngineSession session;
+    session.settings.workers = std::max((int)std::thread::hardware_concurrency(), 1);
+    session.settings.threads = 1;
+    session.settings.hashSize = WORKER_HASH_SIZE_MB;
+    session.settings.selectivity = PROBCUT_DEFAULT_SELECTIVITY;
+    session.settings.endgameEmpties = ENDGAME_DEFAULT_EMPTIES;
+    session.settings.mode = SEARCH_ALPHABETA;
+    session.settings.evalMode = EVAL_PATTERNS;
+    startModel(session.model);
+
+    for (int i = 1; i < argc; i++)
+    {
+        std::string option = argv[i];
+        const char *value = (i + 1 < argc) ? argv[i + 1] : nullptr;
+
+        if ((option.size() < 3) || (option.compare(0, 2, "--") != 0) || !value)
+        {
+            std::cerr << "Usage: engine [--workers N] [--threads N] [--hash MB] "
+                         "[--selectivity N] [--endgame N] [--weights FILE] "
+                         "[--probcut FILE] [--book FILE] [--cache FILE] "
+                         "[--mode alphabeta|mcts] [--eval patterns|network] "
+                         "[--network FILE]"
+                      << std::endl;
+            return 1;
+        }
+        i++;
+
+        std::string error;
+        if (!parseOption(session.settings, option.substr(2), value, error))
+        {
+            std::cerr << error << std::endl;
+            return 1;
+        }
+    }
+
+    // Los motores se crean una sola vez, con todos los ajustes de la lnea de comandos
+    std::string error;
+    if (!prepareEngines(session, error))
+    {
+        std::cerr << error << std::endl;
+        return 1;
+    }
+
+    std::string line;
+    while (std::getline(std::cin, line) && runCommand(session, line))
+        ;
+
+    freeEngines(session);
+
+    return 0;
+}
@@ -0,0 +1,310 @@
+/**
+ * @brief Implements the Reversi pattern evaluation
+ *
+ * @copyright Copyright (c) 2023-2024
+ */
+
+#include <cmath>
+#include <cstring>
+#include <fstream>
+
+#include "eval.h"
+
+#define EVAL_PATTERNS 8
+#define MAX_PATTERN_SQUARES 10
+#define MAX_SQUARE_FEATURES 12
+
+#define EVAL_FILE_MAGIC "EVAL"
+#define EVAL_FILE_VERSION 1
+
+// Patrones, como casillas de una de sus instancias; las dems instancias
+// salen de las ocho simetras del tablero
+static const char *patternSquares[EVAL_PATTERNS] = {
+    "a1b1c1d1e1f1g1h1b2g2", // borde con las dos casillas X
+    "a1b1c1a2b2c2a3b3c3",   // esquina 3x3
+    "a1b1c1d1e1a2b2c2d2e2", // esquina 2x5
+    "a1b2c3d4e5f6g7h8",     // diagonales
+    "b1c2d3e4f5g6h7",
+    "c1d2e3f4g5h6",
+    "d1e2f3g4h5",
+    "e1f2g3h4",
+};
+
+// Valor heurstico de cada casilla en la apertura, en dcimos de ficha
+static const int squareValues[BOARD_SIZE * BOARD_SIZE] = {
+    100, -20, 10, 5, 5, 10, -20, 100,
+    -20, -50, -2, -2, -2, -2, -50, -20,
+    10, -2, -1, -1, -1, -1, -2, 10,
+    5, -2, -1, -1, -1, -1, -2, 5,
+    5, -2, -1, -1, -1, -1, -2, 5,
+    10, -2, -1, -1, -1, -1, -2, 10,
+    -20, -50, -2, -2, -2, -2, -50, -20,
+    100, -20, 10, 5, 5, 10, -20, 100,
+};
+
+struct EvalFileHeader
+{
+    char magic[4];
+    uint32_t version;
+    uint32_t phases;
+    uint32_t tableSize;
+};
+
+// Instancias de los patrones y, para cada casilla, las instancias que la
+// contienen con el peso (potencia de 3) de la casilla en su ndice
+struct EvalTables
+{
+    int patternSizes[EVAL_PATTERNS];
+    int patternOffsets[EVAL_PATTERNS];
+    int tableSize;
+
+    int featurePatterns[EVAL_FEATURES];
+    int featureOffsets[EVAL_FEATURES];
+    int featureSquares[EVAL_FEATURES][MAX_PATTERN_SQUARES];
+
+    int squareFeatureCounts[BOARD_SIZE * BOARD_SIZE];
+    int squareFeatures[BOARD_SIZE * BOARD_SIZE][MAX_SQUARE_FEATURES];
+    int squarePowers[BOARD_SIZE * BOARD_SIZE][MAX_SQUARE_FEATURES];
+
+    EvalTables()
+    {
+        int featureCount = 0;
+        tableSize = 0;
+        memset(squareFeatureCounts, 0, sizeof(squareFeatureCounts));
+
+        for (int pattern = 0; pattern < EVAL_PATTERNS; pattern++)
+        {
+            const char *squares = patternSquares[pattern];
+            int size = (int)strlen(squares) / 2;
+
+            patternSizes[pattern] = size;
+            patternOffsets[pattern] = tableSize;
+            tableSize += (int)std::pow(3, size);
+
+            // Una instancia por simetra, salvo las que cubren las mismas casillas
+            uint64_t instanceMasks[8];
+            int instanceCount = 0;
+            for (int symmetry = 0; symmetry < 8; symmetry++)
+            {
+                int instance[MAX_PATTERN_SQUARES];
+                uint64_t mask = 0;
+                for (int i = 0; i < size; i++)
+                {
+                    instance[i] = transformSquare((squares[2 * i + 1] - '1') * BOARD_SIZE +
+                                                      (squares[2 * i] - 'a'),
+                                                  symmetry);
+                    mask |= squareBit(instance[i]);
+                }
+
+                bool repeated = false;
+                for (int i = 0; i < instanceCount; i++)
+                    repeated = repeated || (instanceMasks[i] == mask);
+                if (repeated)
+                    continue;
+                instanceMasks[instanceCount++] = mask;
+
+                int feature = featureCount++;
+                featurePatterns[feature] = pattern;
+                featureOffsets[feature] = patternOffsets[pattern];
+
+                int power = 1;
+                for (int i = 0; i < size; i++)
+                {
+                    int square = instance[i];
+                    int count = squareFeatureCounts[square]++;
+
+                    featureSquares[feature][i] = square;
+                    squareFeatures[square][count] = feature;
+                    squarePowers[square][count] = power;
+                    power *= 3;
+                }
+            }
+        }
+    }
+
+    // Simetras del tablero: reflejos horizontal y vertical, y transposicin
+    static int transformSquare(int index, int symmetry)
+    {
+        int x = index % BOARD_SIZE;
+        int y = index / BOARD_SIZE;
+
+        if (symmetry & 1)
+            x = BOARD_SIZE - 1 - x;
+        if (symmetry & 2)
+            y = BOARD_SIZE - 1 - y;
+        if (symmetry & 4)
+        {
+            int t = x;
+            x = y;
+            y = t;
+        }
+
+        return y * BOARD_SIZE + x;
+    }
+};
+
+static const EvalTables tables;
+
+int getEvalPhase(GameModel &model)
+{
+    int discs = countBits(model.board[PLAYER_BLACK] | model.board[PLAYER_WHITE]);
+
+    return (discs - 4) * EVAL_PHASES / (BOARD_SIZE * BOARD_SIZE - 3);
+}
+
+double getHeuristicSquareValue(int phase, int index)
+{
+    // La posicin pesa cada vez menos y la cantidad de fichas cada vez ms
+    double positionWeight = (double)(EVAL_PHASES - 1 - phase) / (EVAL_PHASES - 1);
+    double discWeight = (double)phase / (EVAL_PHASES - 1);
+
+    return positionWeight * squareValues[index] / 10 + discWeight;
+}
+
+void initEvalWeights(EvalWeights &weights)
+{
+    weights.values.assign(EVAL_PHASES * tables.tableSize, 0);
+
+    for (int phase = 0; phase < EVAL_PHASES; phase++)
+    {
+        for (int pattern = 0; pattern < EVAL_PATTERNS; pattern++)
+        {
+            int size = tables.patternSizes[pattern];
+            int entries = (int)std::pow(3, size);
+
+            // Las casillas de la primera instancia: las dems son simtricas
+            const int *squares = nullptr;
+            for (int feature = 0; !squares; feature++)
+                if (tables.featurePatterns[feature] == pattern)
+                    squares = tables.featureSquares[feature];
+
+            for (int index = 0; index < entries; index++)
+            {
+                // Cada casilla reparte su valor entre las instancias que la cubren
+                double value = 0;
+                for (int i = 0, digits = index; i < size; i++, digits /= 3)
+                {
+                    int square = squares[i];
+                    int sign = ((digits % 3) == 1) ? 1 : ((digits % 3) == 2) ? -1 : 0;
+
+                    value += sign * getHeuristicSquareValue(phase, square) /
+                             tables.squareFeatureCounts[square];
+                }
+
+                weights.values[phase * tables.tableSize + tables.patternOffsets[pattern] + index] =
+                    (int16_t)std::lround(value * EVAL_SCALE);
+            }
+        }
+    }
+}
+
+bool loadEvalWeights(EvalWeights &weights, const char *path)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+        return false;
+
+    EvalFileHeader header;
+    if (!file.read((char *)&header, sizeof(header)) ||
+        memcmp(header.magic, EVAL_FILE_MAGIC, 4) ||
+        (header.version != EVAL_FILE_VERSION) ||
+        (header.phases != EVAL_PHASES) ||
+        (header.tableSize != (uint32_t)tables.tableSize))
+        return false;
+
+    std::vector<int16_t> values(EVAL_PHASES * tables.tableSize);
+    if (!file.read((char *)values.data(), values.size() * sizeof(int16_t)))
+        return false;
+
+    weights.values.swap(values);
+
+    return true;
+}
+
+bool saveEvalWeights(EvalWeights &weights, const char *path)
+{
+    std::ofstream file(path, std::ios::binary);
+    if (!file)
+        return false;
+
+    EvalFileHeader header;
+    memcpy(header.magic, EVAL_FILE_MAGIC, 4);
+    header.version = EVAL_FILE_VERSION;
+    header.phases = EVAL_PHASES;
+    header.tableSize = tables.tableSize;
+
+    file.write((const char *)&header, sizeof(header));
+    file.write((const char *)weights.values.data(), weights.values.size() * sizeof(int16_t));
+
+    return (bool)file;
+}
+
+void initEvalState(EvalState &state, GameModel &model)
+{
+    for (int feature = 0; feature < EVAL_FEATURES; feature++)
+    {
+        int size = tables.patternSizes[tables.featurePatterns[feature]];
+        int index = 0;
+
+        for (int i = size - 1; i >= 0; i--)
+        {
+            uint64_t bit = squareBit(tables.featureSquares[feature][i]);
+            int digit = (model.board[PLAYER_BLACK] & bit) ? 1 : (model.board[PLAYER_WHITE] & bit) ? 2 : 0;
+
+            index = index * 3 + digit;
+        }
+
+        state.indices[feature] = (uint16_t)index;
+    }
+}
+
+// Suma el cambio de dgito de una casilla a todas las instancias que la contienen
+static inline void updateSquare(EvalState &state, int square, int digitChange)
+{
+    for (int i = 0; i < tables.squareFeatureCounts[square]; i++)
+    {
+        uint16_t &index = state.indices[tables.squareFeatures[square][i]];
+        index = (uint16_t)(index + digitChange * tables.squarePowers[square][i]);
+    }
+}
+
+void updateEvalState(EvalState &state, Player player, int index, uint64_t flips)
+{
+    // Casilla nueva: de vaca (0) a negra (1) o blanca (2); fichas dadas
+    // vuelta: de blanca a negra (-1) o de negra a blanca (+1)
+    int placed = (player == PLAYER_BLACK) ? 1 : 2;
+    int flipped = (player == PLAYER_BLACK) ? -1 : 1;
+
+    updateSquare(state, index, placed);
+    for (; flips; flips &= flips - 1)
+        updateSquare(state, firstBit(flips), flipped);
+}
+
+void restoreEvalState(EvalState &state, Player player, int index, uint64_t flips)
+{
+    int placed = (player == PLAYER_BLACK) ? 1 : 2;
+    int flipped = (player == PLAYER_BLACK) ? -1 : 1;
+
+    updateSquare(state, index, -placed);
+    for (; flips; flips &= flips - 1)
+        updateSquare(state, firstBit(flips), -flipped);
+}
+
+int evaluatePosition(EvalWeights &weights, EvalState &state, GameModel &model)
+{
+    const int16_t *values = &weights.values[getEvalPhase(model) * tables.tableSize];
+
+    int sum = 0;
+    for (int feature = 0; feature < EVAL_FEATURES; feature++)
+        sum += values[tables.featureOffsets[feature] + state.indices[feature]];
+
+    // Redondeo a fichas enteras, dentro de los valores posibles
+    int score = (sum + ((sum >= 0) ? EVAL_SCALE / 2 : -EVAL_SCALE / 2)) / EVAL_SCALE;
+    if (score > BOARD_SIZE * BOARD_SIZE)
+        score = BOARD_SIZE * BOARD_SIZE;
+    else if (score < -BOARD_SIZE * BOARD_SIZE)
+        score = -BOARD_SIZE * BOARD_SIZE;
+
+    // Los pesos son del punto de vista de las negras
+    return (model.currentPlayer == PLAYER_BLACK) ? score : -score;
+}
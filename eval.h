@@ -0,0 +1,126 @@
+/**
+ * @brief Implements the Reversi pattern evaluation
+ *
+ * The board is covered by pattern instances (edges with both X squares,
+ * 3x3 and 2x5 corners, and diagonals of 4 to 8 squares). Each instance's
+ * squares form a base-3 index (empty 0, black 1, white 2) into the weight
+ * table of its pattern, shared by all symmetric instances. There is one set
+ * of tables per game phase.
+ *
+ * @copyright Copyright (c) 2023-2024
+ */
+
+#ifndef EVAL_H
+#define EVAL_H
+
+#include <cstdint>
+#include <vector>
+
+#include "model.h"
+
+#define EVAL_PHASES 6
+#define EVAL_FEATURES 34
+
+// Weights are stored in 1/EVAL_SCALE of a disc
+#define EVAL_SCALE 128
+
+struct EvalWeights
+{
+    // EVAL_PHASES sets of tables, one after the other
+    std::vector<int16_t> values;
+};
+
+// Pattern indices of a position, updated incrementally move by move
+struct EvalState
+{
+    uint16_t indices[EVAL_FEATURES];
+};
+
+/**
+ * @brief Fills the weights with the built-in heuristic.
+ *
+ * Square values favour corners and edges and penalize X and C squares in
+ * the opening, and shift to the disc count towards the end of the game.
+ *
+ * @param weights The weights.
+ */
+void initEvalWeights(EvalWeights &weights);
+
+/**
+ * @brief Returns the value of a disc on a square in the built-in heuristic.
+ *
+ * @param phase The game phase.
+ * @param index The bit index of the square.
+ * @return The value, in discs, for the owner of the disc.
+ */
+double getHeuristicSquareValue(int phase, int index);
+
+/**
+ * @brief Loads the weights from a binary file.
+ *
+ * The file holds a header (magic "EVAL", version, phase count and table
+ * size, as 32-bit integers) followed by the little-endian 16-bit weights of
+ * every phase.
+ *
+ * @param weights The weights (unchanged if the file is missing or invalid).
+ * @param path The file path.
+ * @return Whether the file was loaded.
+ */
+bool loadEvalWeights(EvalWeights &weights, const char *path);
+
+/**
+ * @brief Saves the weights to a binary file (see loadEvalWeights).
+ *
+ * @param weights The weights.
+ * @param path The file path.
+ * @return Whether the file was written.
+ */
+bool saveEvalWeights(EvalWeights &weights, const char *path);
+
+/**
+ * @brief Computes the pattern indices of a position from scratch.
+ *
+ * @param state Receives the indices.
+ * @param model The position.
+ */
+void initEvalState(EvalState &state, GameModel &model);
+
+/**
+ * @brief Updates the pattern indices after a move.
+ *
+ * @param state The indices.
+ * @param player The player who moved.
+ * @param index The bit index of the move.
+ * @param flips The flipped discs.
+ */
+void updateEvalState(EvalState &state, Player player, int index, uint64_t flips);
+
+/**
+ * @brief Undoes updateEvalState.
+ *
+ * @param state The indices.
+ * @param player The player who moved.
+ * @param index The bit index of the move.
+ * @param flips The flipped discs.
+ */
+void restoreEvalState(EvalState &state, Player player, int index, uint64_t flips);
+
+/**
+ * @brief Returns the game phase of a position, from its number of discs.
+ *
+ * @param model The position.
+ * @return The phase (0 to EVAL_PHASES - 1).
+ */
+int getEvalPhase(GameModel &model);
+
+/**
+ * @brief Evaluates a position.
+ *
+ * @param weights The weights.
+ * @param state The pattern indices of the position.
+ * @param model The position.
+ * @return The estimated final disc difference for the player to move.
+ */
+int evaluatePosition(EvalWeights &weights, EvalState &state, GameModel &model);
+
+#endif
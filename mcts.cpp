@@ -0,0 +1,403 @@
+/**
+ * @brief Implements the Reversi Monte Carlo tree search
+ *
+ * @copyright Copyright (c) 2023-2024
+ */
+
+#include <cmath>
+#include <thread>
+#include <vector>
+
+#include "mcts.h"
+#include "ordering.h"
+
+// Peso de la exploracin en PUCT
+#define MCTS_EXPLORATION 1.0f
+
+// Una hoja se expande a partir de su segunda visita: la mayora de las
+// hojas slo se visitan una vez, y expandirlas llenara la pool
+#define MCTS_EXPAND_VISITS 1
+
+// Cada cuntas simulaciones de un hilo se consulta si hay que terminar
+#define MCTS_CHECK_PLAYOUTS 64
+
+// Plies mximos de un camino del rbol (pasar cuenta como jugada)
+#define MCTS_MAX_PLIES (2 * BOARD_SIZE * BOARD_SIZE)
+
+// Profundidad mxima a la que se busca la posicin nueva en el rbol anterior
+#define MCTS_REUSE_PLIES 2
+
+// Peso de cada prioridad esttica de las casillas en la probabilidad previa
+static const float priorWeights[4] = {1, 2, 4, 16};
+
+// Generador xorshift de cada hilo: las simulaciones necesitan muchos
+// nmeros y poca calidad
+static inline uint64_t getRandom(uint64_t &state)
+{
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+
+    return state;
+}
+
+// Aplica una jugada (o un pase) y deja el tablero desde el jugador que mueve
+static inline void playNodeMove(uint64_t &player, uint64_t &opponent, int move)
+{
+    if (move != NODE_PASS_MOVE)
+    {
+        uint64_t flips = getFlipsBitboard(player, opponent, move);
+        player |= flips | squareBit(move);
+        opponent ^= flips;
+    }
+
+    uint64_t swap = player;
+    player = opponent;
+    opponent = swap;
+}
+
+// Simulacin: jugadas al azar hasta el final. Devuelve la diferencia de
+// fichas final para el jugador que mueve
+static int playout(uint64_t player, uint64_t opponent, uint64_t &random)
+{
+    int sign = 1;
+    bool passed = false;
+
+    while (true)
+    {
+        uint64_t moves = getMovesBitboard(player, opponent);
+        if (!moves)
+        {
+            if (passed)
+                break;
+            passed = true;
+        }
+        else
+        {
+            passed = false;
+
+            // La k-sima jugada vlida
+            for (int k = (int)(getRandom(random) % countBits(moves)); k > 0; k--)
+                moves &= moves - 1;
+            int index = firstBit(moves);
+
+            uint64_t flips = getFlipsBitboard(player, opponent, index);
+            player |= flips | squareBit(index);
+            opponent ^= flips;
+        }
+
+        uint64_t swap = player;
+        player = opponent;
+        opponent = swap;
+        sign = -sign;
+    }
+
+    return sign * (countBits(player) - countBits(opponent));
+}
+
+// Resultado en medios puntos para el jugador con esa diferencia de fichas
+static inline uint32_t getHalfPoints(int discDifference)
+{
+    return (discDifference > 0) ? 2 : (discDifference == 0) ? 1 : 0;
+}
+
+// Crea los hijos de una hoja reclamada por el hilo. Devuelve false si la
+// pool est llena (la hoja queda como estaba)
+static bool expandNode(MctsSearch &search, SearchNode &node, uint64_t player, uint64_t opponent)
+{
+    uint64_t moves = getMovesBitboard(player, opponent);
+    int count = countBits(moves);
+
+    // Final del juego: un nodo expandido sin hijos
+    if (!count && !getMovesBitboard(opponent, player))
+    {
+        node.childCount = 0;
+        node.state.store(NODE_EXPANDED, std::memory_order_release);
+        return true;
+    }
+
+    uint32_t firstChild = allocateNodes(search.pool, count ? count : 1);
+    if (firstChild == NODE_NULL)
+    {
+        node.state.store(NODE_LEAF, std::memory_order_release);
+        return false;
+    }
+
+    if (!count)
+    {
+        SearchNode &child = search.pool.nodes[firstChild];
+        child.move = NODE_PASS_MOVE;
+        child.prior = 255;
+        count = 1;
+    }
+    else
+    {
+        float total = 0;
+        for (uint64_t bits = moves; bits; bits &= bits - 1)
+            total += priorWeights[getSquarePrior(firstBit(bits))];
+
+        SearchNode *child = &search.pool.nodes[firstChild];
+        for (uint64_t bits = moves; bits; bits &= bits - 1, child++)
+        {
+            int index = firstBit(bits);
+            child->move = (uint8_t)index;
+            child->prior = (uint8_t)std::lround(255 * priorWeights[getSquarePrior(index)] / total);
+        }
+    }
+
+    node.firstChild.store(firstChild, std::memory_order_relaxed);
+    node.childCount = (uint8_t)count;
+    node.state.store(NODE_EXPANDED, std::memory_order_release);
+
+    return true;
+}
+
+// Elige el hijo con el mayor valor PUCT
+static uint32_t selectChild(MctsSearch &search, SearchNode &node)
+{
+    uint32_t firstChild = node.firstChild.load(std::memory_order_relaxed);
+    uint32_t parentVisits = node.visits.load(std::memory_order_relaxed);
+    uint32_t parentWins = node.wins.load(std::memory_order_relaxed);
+
+    // Valor de los hijos sin visitas: el del nodo para el jugador que mueve
+    float firstPlayValue = parentVisits ? 1 - parentWins / (2.0f * parentVisits) : 0.5f;
+    float exploration = MCTS_EXPLORATION * std::sqrt((float)parentVisits) / 255;
+
+    uint32_t best = firstChild;
+    float bestValue = -1;
+    for (uint32_t i = firstChild; i < firstChild + node.childCount; i++)
+    {
+        SearchNode &child = search.pool.nodes[i];
+        uint32_t visits = child.visits.load(std::memory_order_relaxed);
+        uint32_t wins = child.wins.load(std::memory_order_relaxed);
+
+        float value = visits ? wins / (2.0f * visits) : firstPlayValue;
+        value += exploration * child.prior / (1 + visits);
+        if (value > bestValue)
+        {
+            best = i;
+            bestValue = value;
+        }
+    }
+
+    return best;
+}
+
+// Una simulacin: baja por el rbol, expande la hoja si ya fue visitada,
+// simula desde ella y suma el resultado en el camino
+static void runPlayout(MctsSearch &search, uint64_t &random)
+{
+    uint32_t path[MCTS_MAX_PLIES + 1];
+    int ply = 0;
+    int rootChild = -1;
+
+    uint64_t player = search.rootPlayer;
+    uint64_t opponent = search.rootOpponent;
+    uint32_t index = search.root;
+    uint32_t previousVisits = search.pool.nodes[index].visits.fetch_add(1, std::memory_order_relaxed);
+    path[0] = index;
+
+    int result;
+    while (true)
+    {
+        SearchNode &node = search.pool.nodes[index];
+        uint8_t state = node.state.load(std::memory_order_acquire);
+
+        if (state == NODE_LEAF)
+        {
+            uint8_t expected = NODE_LEAF;
+            if ((previousVisits < MCTS_EXPAND_VISITS) ||
+                !node.state.compare_exchange_strong(expected, NODE_EXPANDING, std::memory_order_acquire) ||
+                !expandNode(search, node, player, opponent))
+            {
+                result = playout(player, opponent, random);
+                break;
+            }
+            state = NODE_EXPANDED;
+        }
+        else if (state == NODE_EXPANDING)
+        {
+            result = playout(player, opponent, random);
+            break;
+        }
+
+        // Final del juego: el resultado es exacto
+        if (!node.childCount)
+        {
+            result = countBits(player) - countBits(opponent);
+            break;
+        }
+
+        index = selectChild(search, node);
+        if (!ply)
+            rootChild = (int)(index - node.firstChild.load(std::memory_order_relaxed));
+
+        SearchNode &child = search.pool.nodes[index];
+        previousVisits = child.visits.fetch_add(1, std::memory_order_relaxed);
+        playNodeMove(player, opponent, child.move);
+        path[++ply] = index;
+    }
+
+    int depth = search.depth.load(std::memory_order_relaxed);
+    while ((ply > depth) && !search.depth.compare_exchange_weak(depth, ply, std::memory_order_relaxed))
+        ;
+
+    if (rootChild >= 0)
+    {
+        search.rootDiscs[rootChild] += (ply % 2) ? -result : result;
+        search.rootPlayouts[rootChild]++;
+    }
+
+    // Cada nodo guarda el resultado del jugador que movi hacia l, que es
+    // el oponente del que mueve en el nodo
+    for (int i = ply; i >= 0; i--)
+    {
+        search.pool.nodes[path[i]].wins.fetch_add(getHalfPoints(-result), std::memory_order_relaxed);
+        result = -result;
+    }
+}
+
+static void searchWorker(MctsSearch *search, uint64_t seed)
+{
+    uint64_t random = seed | 1;
+
+    for (int i = 1;; i++)
+    {
+        if (search->maxPlayouts && (search->playouts >= search->maxPlayouts))
+            break;
+        if (!(i % MCTS_CHECK_PLAYOUTS) && search->isAborted && search->isAborted(search->context))
+            break;
+
+        runPlayout(*search, random);
+        search->playouts++;
+    }
+}
+
+// Busca la posicin entre los descendientes de un nodo, hasta plies jugadas
+static uint32_t findPosition(MctsSearch &search,
+                             uint32_t index,
+                             uint64_t player,
+                             uint64_t opponent,
+                             uint64_t targetPlayer,
+                             uint64_t targetOpponent,
+                             int plies)
+{
+    if ((player == targetPlayer) && (opponent == targetOpponent))
+        return index;
+
+    SearchNode &node = search.pool.nodes[index];
+    if (!plies || (node.state != NODE_EXPANDED))
+        return NODE_NULL;
+
+    for (uint32_t i = node.firstChild; i < node.firstChild + node.childCount; i++)
+    {
+        uint64_t childPlayer = player;
+        uint64_t childOpponent = opponent;
+        playNodeMove(childPlayer, childOpponent, search.pool.nodes[i].move);
+
+        uint32_t found = findPosition(search, i, childPlayer, childOpponent, targetPlayer, targetOpponent, plies - 1);
+        if (found != NODE_NULL)
+            return found;
+    }
+
+    return NODE_NULL;
+}
+
+void initMctsSearch(MctsSearch &search, size_t megabytes)
+{
+    initNodePool(search.pool, megabytes);
+    search.root = NODE_NULL;
+}
+
+int searchMcts(MctsSearch &search, GameModel &model, Square &bestMove)
+{
+    Player opponent = (model.currentPlayer == PLAYER_WHITE) ? PLAYER_BLACK : PLAYER_WHITE;
+    uint64_t player = model.board[model.currentPlayer];
+    uint64_t other = model.board[opponent];
+
+    // Se sigue desde el subrbol de la posicin, si el rbol anterior la
+    // tiene; si no, se empieza de cero
+    uint32_t root = NODE_NULL;
+    if (search.root != NODE_NULL)
+        root = findPosition(search, search.root, search.rootPlayer, search.rootOpponent, player, other, MCTS_REUSE_PLIES);
+    search.root = retainSubtree(search.pool, root);
+    if (search.root == NODE_NULL)
+        search.root = allocateNodes(search.pool, 1);
+    search.rootPlayer = player;
+    search.rootOpponent = other;
+
+    search.playouts = 0;
+    search.depth = 0;
+    for (int i = 0; i < BOARD_SIZE * BOARD_SIZE; i++)
+    {
+        search.rootDiscs[i] = 0;
+        search.rootPlayouts[i] = 0;
+    }
+
+    // La raz se expande antes de repartir el trabajo: siempre hay una
+    // jugada. Si el subrbol conservado llen la pool, se empieza de cero
+    if (search.pool.nodes[search.root].state == NODE_LEAF)
+    {
+        search.pool.nodes[search.root].state = NODE_EXPANDING;
+        if (!expandNode(search, search.pool.nodes[search.root], player, other))
+        {
+            resetNodePool(search.pool);
+            search.root = allocateNodes(search.pool, 1);
+            search.pool.nodes[search.root].state = NODE_EXPANDING;
+            expandNode(search, search.pool.nodes[search.root], player, other);
+        }
+    }
+    SearchNode &rootNode = search.pool.nodes[search.root];
+    search.reusedPlayouts = rootNode.visits;
+
+    std::vector<std::thread> helpers;
+    for (int i = 1; i < search.threads; i++)
+        helpers.push_back(std::thread(searchWorker, &search, 0x9e3779b97f4a7c15ULL * (i + 1)));
+    searchWorker(&search, 0x9e3779b97f4a7c15ULL);
+    for (auto &helper : helpers)
+        helper.join();
+
+    // La jugada ms visitada; a igual visitas, la de mejor resultado
+    uint32_t best = NODE_NULL;
+    for (uint32_t i = rootNode.firstChild; i < rootNode.firstChild + rootNode.childCount; i++)
+    {
+        SearchNode &child = search.pool.nodes[i];
+        if ((best == NODE_NULL) ||
+            (child.visits > search.pool.nodes[best].visits) ||
+            ((child.visits == search.pool.nodes[best].visits) && (child.wins > search.pool.nodes[best].wins)))
+            best = i;
+    }
+
+    bestMove = getIndexSquare(search.pool.nodes[best].move);
+
+    int rootChild = (int)(best - rootNode.firstChild);
+    uint32_t playouts = search.rootPlayouts[rootChild];
+
+    return playouts ? (int)std::lround((double)search.rootDiscs[rootChild] / playouts) : 0;
+}
+
+void getMctsPrincipalVariation(MctsSearch &search, int maxLength, Moves &pv)
+{
+    pv.clear();
+    if (search.root == NODE_NULL)
+        return;
+
+    uint32_t index = search.root;
+    while ((int)pv.size() < maxLength)
+    {
+        SearchNode &node = search.pool.nodes[index];
+        if ((node.state != NODE_EXPANDED) || !node.childCount)
+            break;
+
+        uint32_t best = NODE_NULL;
+        for (uint32_t i = node.firstChild; i < node.firstChild + node.childCount; i++)
+            if ((best == NODE_NULL) || (search.pool.nodes[i].visits > search.pool.nodes[best].visits))
+                best = i;
+        if (!search.pool.nodes[best].visits)
+            break;
+
+        if (search.pool.nodes[best].move != NODE_PASS_MOVE)
+            pv.push_back(getIndexSquare(search.pool.nodes[best].move));
+        index = best;
+    }
+}
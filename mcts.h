@@ -0,0 +1,90 @@
+/**
+ * @brief Implements the Reversi Monte Carlo tree search
+ *
+ * An alternative to the alpha-beta search: the search grows a tree of
+ * positions from the root, choosing at each node the move with the best
+ * PUCT value (the mean result of the move plus an exploration term weighted
+ * by a prior from the static square priorities), and estimates each new
+ * leaf with a random playout to the end of the game. Several threads grow
+ * the same tree at once; a visit counts as a loss until its playout ends
+ * (virtual loss), so the threads spread over different branches.
+ *
+ * The nodes come from a fixed pool (see nodepool.h). When the pool is full
+ * the tree stops growing and the playouts go on from its leaves. Between
+ * moves, the subtree of the new position is kept and the rest of the pool
+ * is recycled.
+ *
+ * @copyright Copyright (c) 2023-2024
+ */
+
+#ifndef MCTS_H
+#define MCTS_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include "model.h"
+#include "nodepool.h"
+
+struct MctsSearch
+{
+    NodePool pool;
+    // The root, or NODE_NULL before the first search
+    uint32_t root;
+    // Position of the root, from the side to move
+    uint64_t rootPlayer;
+    uint64_t rootOpponent;
+
+    int threads;
+    // Most playouts of a search (0 for no limit)
+    uint64_t maxPlayouts;
+    // Polled every few playouts with the context; returns true to stop the search
+    bool (*isAborted)(void *context);
+    void *context;
+
+    // Results of the last search
+    std::atomic<uint64_t> playouts;
+    // Deepest ply of the tree reached by the search
+    std::atomic<int> depth;
+    // Playouts of the tree kept from the previous search
+    uint64_t reusedPlayouts;
+    // Sum and count of the final disc differences (for the root player) of
+    // the playouts through each child of the root
+    std::atomic<int64_t> rootDiscs[BOARD_SIZE * BOARD_SIZE];
+    std::atomic<uint32_t> rootPlayouts[BOARD_SIZE * BOARD_SIZE];
+};
+
+/**
+ * @brief Allocates the node pool of a search and clears its tree.
+ *
+ * @param search The search.
+ * @param megabytes The memory budget of the tree.
+ */
+void initMctsSearch(MctsSearch &search, size_t megabytes);
+
+/**
+ * @brief Searches a position until the playout limit or the abort callback
+ * stops it, and returns its best move (the most visited).
+ *
+ * Continues from the tree of the previous search if the position is in it
+ * (up to two plies below its root).
+ *
+ * @param search The search (threads, limits and abort callback).
+ * @param model The position (must have valid moves).
+ * @param bestMove Receives the best move.
+ * @return The mean final disc difference of the best move's playouts, for
+ *         the player to move.
+ */
+int searchMcts(MctsSearch &search, GameModel &model, Square &bestMove);
+
+/**
+ * @brief Returns the most visited line of the tree of the last search.
+ *
+ * @param search The search.
+ * @param maxLength The most moves.
+ * @param pv Receives the moves (passes are skipped).
+ */
+void getMctsPrincipalVariation(MctsSearch &search, int maxLength, Moves &pv);
+
+#endif
@@ -1,20 +1,66 @@
 
-#include "raylib.h"
+
 #include <array>
+#include <chrono>
 
 #include "model.h"
 
-void initModel(GameModel &model)
+// Claves de Zobrist: una por pieza y casilla, ms una para el turno de las
+// blancas. Alcanzan para todos los tableros, que no superan el de BOARD_SIZE
+struct ZobristKeys
+{
+    uint64_t pieces[2][BOARD_SIZE * BOARD_SIZE];
+    uint64_t flips[BOARD_SIZE * BOARD_SIZE];
+    uint64_t whiteToMove;
+
+    ZobristKeys()
+    {
+        // SplitMix64 con semilla fija: el hash es el mismo en cada ejecucin
+        uint64_t seed = 0x9e3779b97f4a7c15ULL;
+        for (int i = 0; i < BOARD_SIZE * BOARD_SIZE; i++)
+        {
+            pieces[PLAYER_BLACK][i] = nextKey(seed);
+            pieces[PLAYER_WHITE][i] = nextKey(seed);
+            flips[i] = pieces[PLAYER_BLACK][i] ^ pieces[PLAYER_WHITE][i];
+        }
+        whiteToMove = nextKey(seed);
+    }
+
+    static uint64_t nextKey(uint64_t &seed)
+    {
+        uint64_t z = (seed += 0x9e3779b97f4a7c15ULL);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        return z ^ (z >> 31);
+    }
+};
+
+static const ZobristKeys zobrist;
+
+template <int Size>
+void initModel(BoardModel<Size> &model)
 {
     model.gameOver = true;
 
     model.playerTime[0] = 0;
     model.playerTime[1] = 0;
 
-    memset(model.board, PIECE_EMPTY, sizeof(model.board));
+    model.board[PLAYER_BLACK] = 0;
+    model.board[PLAYER_WHITE] = 0;
+    model.hash = 0;
+}
+
+// Reloj montono en segundos: el modelo no depende de la vista, as que
+// tambin funciona en los programas sin ventana (arena, perft)
+static double getClockTime()
+{
+    using Clock = std::chrono::steady_clock;
+
+    return std::chrono::duration<double>(Clock::now().time_since_epoch()).count();
 }
 
-void startModel(GameModel &model)
+template <int Size>
+void startModel(BoardModel<Size> &model)
 {
     model.gameOver = false;
 
@@ -22,181 +68,295 @@ void startModel(GameModel &model)
 
     model.playerTime[0] = 0;
     model.playerTime[1] = 0;
-    model.turnTimer = GetTime();
-
-    memset(model.board, PIECE_EMPTY, sizeof(model.board));
-    model.board[BOARD_SIZE / 2 - 1][BOARD_SIZE / 2 - 1] = PIECE_WHITE;
-    model.board[BOARD_SIZE / 2 - 1][BOARD_SIZE / 2] = PIECE_BLACK;
-    model.board[BOARD_SIZE / 2][BOARD_SIZE / 2] = PIECE_WHITE;
-    model.board[BOARD_SIZE / 2][BOARD_SIZE / 2 - 1] = PIECE_BLACK;
+    model.turnTimer = getClockTime();
+
+    model.board[PLAYER_BLACK] = 0;
+    model.board[PLAYER_WHITE] = 0;
+    model.hash = 0;
+    setBoardPiece(model, {Size / 2 - 1, Size / 2 - 1}, PIECE_WHITE);
+    setBoardPiece(model, {Size / 2, Size / 2 - 1}, PIECE_BLACK);
+    setBoardPiece(model, {Size / 2, Size / 2}, PIECE_WHITE);
+    setBoardPiece(model, {Size / 2 - 1, Size / 2}, PIECE_BLACK);
 }
 
-Player getCurrentPlayer(GameModel &model)
+template <int Size>
+Player getCurrentPlayer(BoardModel<Size> &model)
 {
     return model.currentPlayer;
 }
 
-int getScore(GameModel &model, Player player)
+template <int Size>
+int getScore(BoardModel<Size> &model, Player player)
 {
-    int score = 0;
-
-    for (int y = 0; y < BOARD_SIZE; y++)
-        for (int x = 0; x < BOARD_SIZE; x++)
-        {
-            if (((model.board[y][x] == PIECE_WHITE) &&
-                 (player == PLAYER_WHITE)) ||
-                ((model.board[y][x] == PIECE_BLACK) &&
-                 (player == PLAYER_BLACK)))
-                score++;
-        }
-
-    return score;
+    return countBits(model.board[player]);
 }
 
-double getTimer(GameModel &model, Player player)
+template <int Size>
+double getTimer(BoardModel<Size> &model, Player player)
 {
     double turnTime = 0;
 
     if (!model.gameOver && (player == model.currentPlayer))
-        turnTime = GetTime() - model.turnTimer;
+        turnTime = getClockTime() - model.turnTimer;
 
     return model.playerTime[player] + turnTime;
 }
 
-Piece getBoardPiece(GameModel &model, Square square)
+template <int Size>
+Piece getBoardPiece(BoardModel<Size> &model, Square square)
 {
-    return model.board[square.y][square.x];
+    uint64_t bit = squareBit(getSquareIndex<Size>(square));
+
+    if (model.board[PLAYER_BLACK] & bit)
+        return PIECE_BLACK;
+    else if (model.board[PLAYER_WHITE] & bit)
+        return PIECE_WHITE;
+    else
+        return PIECE_EMPTY;
 }
 
-void setBoardPiece(GameModel &model, Square square, Piece piece)
+template <int Size>
+void setBoardPiece(BoardModel<Size> &model, Square square, Piece piece)
 {
-    model.board[square.y][square.x] = piece;
+    int index = getSquareIndex<Size>(square);
+    uint64_t bit = squareBit(index);
+
+    // Saca la pieza anterior del hash
+    if (model.board[PLAYER_BLACK] & bit)
+        model.hash ^= zobrist.pieces[PLAYER_BLACK][index];
+    else if (model.board[PLAYER_WHITE] & bit)
+        model.hash ^= zobrist.pieces[PLAYER_WHITE][index];
+
+    model.board[PLAYER_BLACK] &= ~bit;
+    model.board[PLAYER_WHITE] &= ~bit;
+
+    if (piece == PIECE_BLACK)
+    {
+        model.board[PLAYER_BLACK] |= bit;
+        model.hash ^= zobrist.pieces[PLAYER_BLACK][index];
+    }
+    else if (piece == PIECE_WHITE)
+    {
+        model.board[PLAYER_WHITE] |= bit;
+        model.hash ^= zobrist.pieces[PLAYER_WHITE][index];
+    }
 }
 
-
+template <int Size>
 bool isSquareValid(Square square)
 {
     return (square.x >= 0) &&
-           (square.x < BOARD_SIZE) &&
+           (square.x < Size) &&
            (square.y >= 0) &&
-           (square.y < BOARD_SIZE);
+           (square.y < Size);
 }
 
-// Analiza si hay una jugada vlida en la direccin pedida
-bool analyseInDir(GameModel &model, Square square, Piece anPiece, const int dx, const int dy)
+// Corre el bitboard una casilla en la direccin pedida (shift > 0: hacia ndices mayores)
+static inline uint64_t shiftBitboard(uint64_t bitboard, int shift)
 {
-    if ( isSquareValid({ square.x + dx, square.y + dy}) && getBoardPiece(model, { square.x + dx, square.y + dy }) != PIECE_EMPTY 
-        && getBoardPiece(model, { square.x + dx, square.y + dy }) != anPiece)
-        for ( int i = dx, j = dy; isSquareValid({ square.x + i , square.y + j }) && 
-                getBoardPiece(model, { square.x + i, square.y + j }) != PIECE_EMPTY ; i += dx, j+= dy )
-            if (getBoardPiece(model, { square.x + i , square.y + j }) == anPiece)
-                return true;
-    
-    return false;
+    return (shift > 0) ? (bitboard << shift) : (bitboard >> -shift);
 }
 
-// Cambia las piezas a toFlip en la direccin pedida hasta encontrar otra pieza toFlip
-void flipInDir(GameModel &model, Square square, Piece toFlip, int dx, int dy)
+// Corrimientos de las ocho direcciones (horizontal, vertical y diagonales)
+template <int Size>
+struct DirectionShifts
+{
+    static const int shifts[8];
+};
+
+template <int Size>
+const int DirectionShifts<Size>::shifts[8] = {
+    BoardGeometry<Size>::horizontalShift,
+    -BoardGeometry<Size>::horizontalShift,
+    BoardGeometry<Size>::verticalShift,
+    -BoardGeometry<Size>::verticalShift,
+    BoardGeometry<Size>::antidiagonalShift,
+    -BoardGeometry<Size>::antidiagonalShift,
+    BoardGeometry<Size>::diagonalShift,
+    -BoardGeometry<Size>::diagonalShift,
+};
+
+template <int Size>
+uint64_t getMovesBitboard(uint64_t player, uint64_t opponent)
 {
-    for ( int i = dx, j = dy; isSquareValid({ square.x + i , square.y + j }) && 
-        getBoardPiece(model, { square.x + i, square.y + j }) != toFlip; i += dx, j+= dy )
-        setBoardPiece(model, { square.x + i, square.y + j }, toFlip);
+    const int verticalShift = BoardGeometry<Size>::verticalShift;
+
+    uint64_t empty = ~(player | opponent) & BoardGeometry<Size>::boardMask;
+    uint64_t inner = opponent & BoardGeometry<Size>::innerFilesMask;
+    uint64_t moves = 0;
+
+    // Prefijo paralelo (Kogge-Stone): cada paso duplica el largo de las
+    // cadenas de fichas enemigas propagadas desde las fichas propias
+    for (int i = 0; i < 8; i++)
+    {
+        int shift = DirectionShifts<Size>::shifts[i];
+        uint64_t mask = (shift == verticalShift || shift == -verticalShift) ? opponent : inner;
+
+        uint64_t flip = mask & shiftBitboard(player, shift);
+        flip |= mask & shiftBitboard(flip, shift);
+
+        uint64_t pre = mask & shiftBitboard(mask, shift);
+        flip |= pre & shiftBitboard(flip, 2 * shift);
+        flip |= pre & shiftBitboard(flip, 2 * shift);
+
+        moves |= shiftBitboard(flip, shift);
+    }
+
+    return moves & empty;
 }
 
-void getValidMoves(GameModel &model, Moves &validMoves)
+template <int Size>
+uint64_t getFlipsBitboard(uint64_t player, uint64_t opponent, int index)
 {
-    Piece oppPiece =
-        (getCurrentPlayer(model) == PLAYER_WHITE)
-        ? PIECE_BLACK
-        : PIECE_WHITE;
-    Piece selfPiece = 
-        (getCurrentPlayer(model) == PLAYER_WHITE)
-        ? PIECE_WHITE
-        : PIECE_BLACK;
+    const int verticalShift = BoardGeometry<Size>::verticalShift;
 
-   
-    for (int y = 0; y < BOARD_SIZE; y++)
-        for (int x = 0; x < BOARD_SIZE; x++)
-        {
-            Square move = { x, y }, auxMove = move;
+    uint64_t move = squareBit(index);
+    uint64_t inner = opponent & BoardGeometry<Size>::innerFilesMask;
+    uint64_t flips = 0;
 
-            // Me fijo dnde estn los lugares vacios del tablero
-            if (getBoardPiece(model, move) == PIECE_EMPTY)
-            {
-                // Indica si existe al menos una jugada valida
-                bool flag = analyseInDir(model, move, selfPiece, -1, -1) || analyseInDir(model, move, selfPiece, -1, 0) ||
-                    analyseInDir(model, move, selfPiece, -1, 1) || analyseInDir(model, move, selfPiece, 0, -1) ||
-                    analyseInDir(model, move, selfPiece, 0, 1) || analyseInDir(model, move, selfPiece, 1, -1) ||
-                    analyseInDir(model, move, selfPiece, 1, 0) || analyseInDir(model, move, selfPiece, 1, 1);
+    if ((player | opponent) & move)
+        return 0;
 
-                if (flag)
-                    validMoves.push_back(move);
-            }
+    // Avanza sobre fichas enemigas hasta encontrar una ficha propia
+    for (int i = 0; i < 8; i++)
+    {
+        int shift = DirectionShifts<Size>::shifts[i];
+        uint64_t mask = (shift == verticalShift || shift == -verticalShift) ? opponent : inner;
 
+        uint64_t line = 0;
+        uint64_t next = mask & shiftBitboard(move, shift);
+        while (next)
+        {
+            line |= next;
+            next = mask & shiftBitboard(next, shift);
         }
-    
+
+        if (line && (player & shiftBitboard(line, shift) & ~line))
+            flips |= line;
+    }
+
+    return flips;
+}
+
+template <int Size>
+uint64_t getValidMovesBitboard(BoardModel<Size> &model)
+{
+    Player player = getCurrentPlayer(model);
+    Player opponent = (player == PLAYER_WHITE) ? PLAYER_BLACK : PLAYER_WHITE;
+
+    return getMovesBitboard<Size>(model.board[player], model.board[opponent]);
 }
 
-bool playMove(GameModel &model, Square move)
+uint64_t getMoveHashKey(Player player, int index, uint64_t flips)
 {
-    // Set game piece
-    Piece piece =
-        (getCurrentPlayer(model) == PLAYER_WHITE)
-            ? PIECE_WHITE
-            : PIECE_BLACK;
+    // La ficha nueva, las fichas dadas vuelta y el cambio de turno
+    uint64_t key = zobrist.pieces[player][index] ^ zobrist.whiteToMove;
+    for (; flips; flips &= flips - 1)
+        key ^= zobrist.flips[firstBit(flips)];
 
-    setBoardPiece(model, move, piece);
+    return key;
+}
 
-    Piece pieceEnemy =
-        (getCurrentPlayer(model) == PLAYER_WHITE)
-        ? PIECE_BLACK
-        : PIECE_WHITE;
-    
-    Square auxSquare;
+template <int Size>
+void getValidMoves(BoardModel<Size> &model, Moves &validMoves)
+{
+    // Los ndices crecientes recorren el tablero en orden de filas
+    for (uint64_t moves = getValidMovesBitboard(model); moves; moves &= moves - 1)
+        validMoves.push_back(getIndexSquare<Size>(firstBit(moves)));
+}
 
-    // Analiza y cambia el color de las distintas jugadas posibles en esa posicin (analiza las posiciones adyacentes)
-    if (analyseInDir(model, move, piece, -1, -1))
-        flipInDir(model, move, piece, -1, -1);
+uint64_t getPassHashKey()
+{
+    return zobrist.whiteToMove;
+}
 
-    if (analyseInDir(model, move, piece, -1, 0))
-        flipInDir(model, move, piece, -1, 0);
+template <int Size>
+uint64_t makeMove(BoardModel<Size> &model, int index)
+{
+    Player player = model.currentPlayer;
+    Player opponent = (player == PLAYER_WHITE) ? PLAYER_BLACK : PLAYER_WHITE;
 
-    if (analyseInDir(model, move, piece, -1, 1))
-        flipInDir(model, move, piece, -1, 1);
+    // Coloca la ficha y da vuelta las fichas encerradas en las ocho direcciones
+    uint64_t flips = getFlipsBitboard<Size>(model.board[player], model.board[opponent], index);
 
-    if (analyseInDir(model, move, piece, 0, -1))
-        flipInDir(model, move, piece, 0, -1);
-          
-    if (analyseInDir(model, move, piece, 0, 1))
-        flipInDir(model, move, piece, 0, 1);
+    model.board[player] |= flips | squareBit(index);
+    model.board[opponent] &= ~flips;
 
-    if (analyseInDir(model, move, piece, 1, -1))
-        flipInDir(model, move, piece, 1, -1);
+    // Actualiza el hash en forma incremental
+    model.hash ^= getMoveHashKey(player, index, flips);
 
-    if (analyseInDir(model, move, piece, 1, 0))
-        flipInDir(model, move, piece, 1, 0);
+    model.currentPlayer = opponent;
 
-    if (analyseInDir(model, move, piece, 1, 1))
-        flipInDir(model, move, piece, 1, 1);
+    return flips;
+}
+
+template <int Size>
+void unmakeMove(BoardModel<Size> &model, int index, uint64_t flips)
+{
+    Player opponent = model.currentPlayer;
+    Player player = (opponent == PLAYER_WHITE) ? PLAYER_BLACK : PLAYER_WHITE;
+
+    // Saca la ficha y devuelve las fichas dadas vuelta
+    model.board[player] &= ~(flips | squareBit(index));
+    model.board[opponent] |= flips;
+
+    model.hash ^= getMoveHashKey(player, index, flips);
+
+    model.currentPlayer = player;
+}
+
+template <int Size>
+void makePass(BoardModel<Size> &model)
+{
+    model.currentPlayer = (model.currentPlayer == PLAYER_WHITE) ? PLAYER_BLACK : PLAYER_WHITE;
+    model.hash ^= zobrist.whiteToMove;
+}
+
+template <int Size>
+bool playMove(BoardModel<Size> &model, Square move)
+{
+    int index = getSquareIndex<Size>(move);
+    if (!isSquareValid<Size>(move) || !(getValidMovesBitboard(model) & squareBit(index)))
+        return false;
 
     // Update timer
-    double currentTime = GetTime();
+    double currentTime = getClockTime();
     model.playerTime[model.currentPlayer] += currentTime - model.turnTimer;
     model.turnTimer = currentTime;
 
-    // Swap player
-    model.currentPlayer =
-        (model.currentPlayer == PLAYER_WHITE)
-            ? PLAYER_BLACK
-            : PLAYER_WHITE;
+    makeMove(model, index);
 
-    // Game over?
-    Moves validMoves;
-    getValidMoves(model, validMoves);
+    // Si el oponente no tiene jugadas pasa, y vuelve a jugar el mismo
+    // jugador; si ninguno puede jugar, el juego termin
+    if (!getValidMovesBitboard(model))
+    {
+        makePass(model);
 
-    if (validMoves.size() == 0)
-        model.gameOver = true;
+        if (!getValidMovesBitboard(model))
+            model.gameOver = true;
+    }
 
     return true;
 }
 
+// Tableros de 6x6 y 8x8: los dos pueden usarse en el mismo programa
+#define INSTANTIATE_MODEL(Size)                                                              \
+    template void initModel(BoardModel<Size> &model);                                        \
+    template void startModel(BoardModel<Size> &model);                                       \
+    template Player getCurrentPlayer(BoardModel<Size> &model);                               \
+    template int getScore(BoardModel<Size> &model, Player player);                           \
+    template double getTimer(BoardModel<Size> &model, Player player);                        \
+    template Piece getBoardPiece(BoardModel<Size> &model, Square square);                    \
+    template void setBoardPiece(BoardModel<Size> &model, Square square, Piece piece);        \
+    template bool isSquareValid<Size>(Square square);                                        \
+    template uint64_t getMovesBitboard<Size>(uint64_t player, uint64_t opponent);            \
+    template uint64_t getFlipsBitboard<Size>(uint64_t player, uint64_t opponent, int index); \
+    template uint64_t getValidMovesBitboard(BoardModel<Size> &model);                        \
+    template void getValidMoves(BoardModel<Size> &model, Moves &validMoves);                 \
+    template uint64_t makeMove(BoardModel<Size> &model, int index);                          \
+    template void unmakeMove(BoardModel<Size> &model, int index, uint64_t flips);            \
+    template void makePass(BoardModel<Size> &model);                                         \
+    template bool playMove(BoardModel<Size> &model, Square move);
+
+INSTANTIATE_MODEL(6)
+INSTANTIATE_MODEL(8)
@@ -11,6 +11,11 @@
 #include <cstdint>
 #include <vector>
 
+#include "bitboard.h"
+
+// Board size of the game played by the GUI and the AI. The model and the
+// move generator are templates on the board size, instantiated for 6x6 and
+// 8x8 boards; their functions default to BOARD_SIZE
 #define BOARD_SIZE 8
 
 enum Player
@@ -37,7 +42,8 @@ struct Square
         -1, -1              \
     }
 
-struct GameModel
+template <int Size>
+struct BoardModel
 {
     bool gameOver;
 
@@ -46,26 +52,58 @@ struct GameModel
     double playerTime[2];
     double turnTimer;
 
-    Piece board[BOARD_SIZE][BOARD_SIZE];
+    // Occupancy masks indexed by Player; bit (y * Size + x) is square {x, y}
+    uint64_t board[2];
+
+    // Zobrist hash of the position (pieces and player to move)
+    uint64_t hash;
 
     Player humanPlayer;
 };
 
+typedef BoardModel<BOARD_SIZE> GameModel;
+
 typedef std::vector<Square> Moves;
 
+/**
+ * @brief Converts a square to its bitboard index.
+ *
+ * @param square The square.
+ * @return The bit index.
+ */
+template <int Size = BOARD_SIZE>
+inline int getSquareIndex(Square square)
+{
+    return square.y * Size + square.x;
+}
+
+/**
+ * @brief Converts a bitboard index to its square.
+ *
+ * @param index The bit index.
+ * @return The square.
+ */
+template <int Size = BOARD_SIZE>
+inline Square getIndexSquare(int index)
+{
+    return {index % Size, index / Size};
+}
+
 /**
  * @brief Initializes a game model.
  *
  * @param model The game model.
  */
-void initModel(GameModel &model);
+template <int Size>
+void initModel(BoardModel<Size> &model);
 
 /**
  * @brief Starts a game.
  *
  * @param model The game model.
  */
-void startModel(GameModel &model);
+template <int Size>
+void startModel(BoardModel<Size> &model);
 
 /**
  * @brief Returns the model's current player.
@@ -73,7 +111,8 @@ void startModel(GameModel &model);
  * @param model The game model.
  * @return PLAYER_WHITE or PLAYER_BLACK.
  */
-Player getCurrentPlayer(GameModel &model);
+template <int Size>
+Player getCurrentPlayer(BoardModel<Size> &model);
 
 /**
  * @brief Returns the model's current score.
@@ -82,7 +121,8 @@ Player getCurrentPlayer(GameModel &model);
  * @param player The player (PLAYER_WHITE or PLAYER_BLACK).
  * @return The score.
  */
-int getScore(GameModel &model, Player player);
+template <int Size>
+int getScore(BoardModel<Size> &model, Player player);
 
 /**
  * @brief Returns the game timer for a player.
@@ -91,7 +131,8 @@ int getScore(GameModel &model, Player player);
  * @param player The player (PLAYER_WHITE or PLAYER_BLACK).
  * @return The time in seconds.
  */
-double getTimer(GameModel &model, Player player);
+template <int Size>
+double getTimer(BoardModel<Size> &model, Player player);
 
 /**
  * @brief Return a model's piece.
@@ -100,7 +141,8 @@ double getTimer(GameModel &model, Player player);
  * @param square The square.
  * @return The piece at the square.
  */
-Piece getBoardPiece(GameModel &model, Square square);
+template <int Size>
+Piece getBoardPiece(BoardModel<Size> &model, Square square);
 
 /**
  * @brief Sets a model's piece.
@@ -109,7 +151,8 @@ Piece getBoardPiece(GameModel &model, Square square);
  * @param square The square.
  * @param piece The piece to be set
  */
-void setBoardPiece(GameModel &model, Square square, Piece piece);
+template <int Size>
+void setBoardPiece(BoardModel<Size> &model, Square square, Piece piece);
 
 /**
  * @brief Checks whether a square is within the board.
@@ -117,6 +160,7 @@ void setBoardPiece(GameModel &model, Square square, Piece piece);
  * @param square The square.
  * @return True or false.
  */
+template <int Size = BOARD_SIZE>
 bool isSquareValid(Square square);
 
 /**
@@ -125,15 +169,104 @@ bool isSquareValid(Square square);
  * @param model The game model.
  * @param validMoves A list that receives the valid moves.
  */
-void getValidMoves(GameModel &model, Moves &validMoves);
+template <int Size>
+void getValidMoves(BoardModel<Size> &model, Moves &validMoves);
+
+/**
+ * @brief Returns the valid moves of a position as a bitboard.
+ *
+ * All squares are computed at once with shift-and-mask direction fills.
+ *
+ * @param player The bitboard of the player to move.
+ * @param opponent The bitboard of the opponent.
+ * @return The bitboard of valid moves.
+ */
+template <int Size = BOARD_SIZE>
+uint64_t getMovesBitboard(uint64_t player, uint64_t opponent);
+
+/**
+ * @brief Returns the discs flipped by a move.
+ *
+ * @param player The bitboard of the player to move.
+ * @param opponent The bitboard of the opponent.
+ * @param index The bit index of the move.
+ * @return The bitboard of flipped discs (zero if the move is invalid).
+ */
+template <int Size = BOARD_SIZE>
+uint64_t getFlipsBitboard(uint64_t player, uint64_t opponent, int index);
+
+/**
+ * @brief Returns the valid moves for the current player as a bitboard.
+ *
+ * @param model The game model.
+ * @return The bitboard of valid moves.
+ */
+template <int Size>
+uint64_t getValidMovesBitboard(BoardModel<Size> &model);
+
+/**
+ * @brief Returns the change of the Zobrist hash made by a move.
+ *
+ * Covers the placed disc, the flipped discs and the change of turn, so the
+ * hash of the next position is the current hash XOR this key.
+ *
+ * @param player The player who moves.
+ * @param index The bit index of the move.
+ * @param flips The bitboard of flipped discs.
+ * @return The hash key of the move.
+ */
+uint64_t getMoveHashKey(Player player, int index, uint64_t flips);
+
+/**
+ * @brief Returns the change of the Zobrist hash made by a pass.
+ *
+ * @return The hash key of the change of turn.
+ */
+uint64_t getPassHashKey();
+
+/**
+ * @brief Makes a move for the search.
+ *
+ * Places the disc, flips the enclosed discs, updates the hash and passes
+ * the turn. Unlike playMove, it neither updates the timers nor checks for
+ * the end of the game.
+ *
+ * @param model The game model.
+ * @param index The bit index of the move (must be valid).
+ * @return The bitboard of flipped discs, to undo the move with unmakeMove.
+ */
+template <int Size>
+uint64_t makeMove(BoardModel<Size> &model, int index);
+
+/**
+ * @brief Undoes a move made with makeMove.
+ *
+ * @param model The game model.
+ * @param index The bit index of the move.
+ * @param flips The bitboard returned by makeMove.
+ */
+template <int Size>
+void unmakeMove(BoardModel<Size> &model, int index, uint64_t flips);
+
+/**
+ * @brief Passes the turn without moving (it also undoes a pass).
+ *
+ * @param model The game model.
+ */
+template <int Size>
+void makePass(BoardModel<Size> &model);
 
 /**
  * @brief Plays a move.
  *
+ * If the opponent has no valid moves afterwards, it passes and the same
+ * player moves again; if neither player can move, the game is over.
+ *
  * @param model The game model.
  * @param square The move.
- * @return Move accepted.
+ * @return Move accepted (false if the move is not valid).
  */
-bool playMove(GameModel &model, Square move);
+template <int Size>
+bool playMove(BoardModel<Size> &model, Square move);
 
 #endif
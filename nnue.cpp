@@ -0,0 +1,464 @@
+/**
+ * @brief Implements a small quantized neural network evaluation (NNUE)
+ *
+ * @copyright Copyright (c) 2023-2024
+ */
+
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <utility>
+
+#include "nnue.h"
+
+#define NNUE_FILE_MAGIC "NNUE"
+#define NNUE_FILE_VERSION 1
+
+// Corrimiento de la capa oculta: sus pesos valen 1 / 2^NNUE_LAYER_SHIFT
+#define NNUE_LAYER_SHIFT 6
+// Mximo de las activaciones recortadas
+#define NNUE_ACTIVATION_MAX 127
+
+// Unidades por ficha de los acumuladores de la red heurstica
+#define HEURISTIC_UNITS 4
+
+// Igual que en batch.cpp: las versiones vectoriales se compilan con
+// atributos de destino y slo se llaman si la CPU tiene las instrucciones
+#if (defined(__GNUC__) || defined(__clang__)) && defined(__x86_64__)
+#define NNUE_X86
+#define NNUE_TARGET_AVX2 __attribute__((target("avx2")))
+#include <immintrin.h>
+#elif defined(_MSC_VER) && defined(_M_X64)
+#define NNUE_X86
+#define NNUE_TARGET_AVX2
+#include <immintrin.h>
+#endif
+
+struct NnueFileHeader
+{
+    char magic[4];
+    uint32_t version;
+    uint32_t inputs;
+    uint32_t hidden;
+    uint32_t layer;
+    uint32_t buckets;
+};
+
+static BatchBackend nnueBackend = isBatchBackendSupported(BATCH_AVX2) ? BATCH_AVX2 : BATCH_SCALAR;
+
+void prepareNnueWeights(NnueWeights &weights)
+{
+    weights.flipWeights.resize(BOARD_SIZE * BOARD_SIZE * NNUE_HIDDEN);
+
+    for (int square = 0; square < BOARD_SIZE * BOARD_SIZE; square++)
+    {
+        const int16_t *own = &weights.featureWeights[square * NNUE_HIDDEN];
+        const int16_t *opponent = &weights.featureWeights[(BOARD_SIZE * BOARD_SIZE + square) * NNUE_HIDDEN];
+
+        for (int i = 0; i < NNUE_HIDDEN; i++)
+            weights.flipWeights[square * NNUE_HIDDEN + i] = (int16_t)(own[i] - opponent[i]);
+    }
+}
+
+void initNnueWeights(NnueWeights &weights)
+{
+    weights.featureWeights.assign(NNUE_INPUTS * NNUE_HIDDEN, 0);
+    weights.featureBiases.assign(NNUE_HIDDEN, 0);
+    weights.layerWeights.assign(NNUE_LAYER * 2 * NNUE_HIDDEN, 0);
+    weights.layerBiases.assign(NNUE_LAYER, 0);
+    weights.outputWeights.assign(NNUE_BUCKETS * NNUE_LAYER, 0);
+    weights.outputBiases.assign(NNUE_BUCKETS, 0);
+
+    for (int phase = 0; phase < NNUE_BUCKETS; phase++)
+    {
+        // Neuronas 2 * phase y 2 * phase + 1: la suma de los valores de las
+        // casillas, en cuartos de ficha, y la suma cambiada de signo; el
+        // recorte deja la parte positiva de cada una
+        int positive = 2 * phase;
+        int negative = 2 * phase + 1;
+
+        for (int square = 0; square < BOARD_SIZE * BOARD_SIZE; square++)
+        {
+            int value = (int)std::lround(HEURISTIC_UNITS * getHeuristicSquareValue(phase, square));
+            int16_t *own = &weights.featureWeights[square * NNUE_HIDDEN];
+            int16_t *opponent = &weights.featureWeights[(BOARD_SIZE * BOARD_SIZE + square) * NNUE_HIDDEN];
+
+            own[positive] = (int16_t)value;
+            own[negative] = (int16_t)-value;
+            opponent[positive] = (int16_t)-value;
+            opponent[negative] = (int16_t)value;
+        }
+
+        // La capa oculta copia las dos partes del lado que mueve, y la
+        // salida de la fase las resta
+        weights.layerWeights[positive * 2 * NNUE_HIDDEN + positive] = 1 << NNUE_LAYER_SHIFT;
+        weights.layerWeights[negative * 2 * NNUE_HIDDEN + negative] = 1 << NNUE_LAYER_SHIFT;
+        weights.outputWeights[phase * NNUE_LAYER + positive] = NNUE_OUTPUT_SCALE / HEURISTIC_UNITS;
+        weights.outputWeights[phase * NNUE_LAYER + negative] = -NNUE_OUTPUT_SCALE / HEURISTIC_UNITS;
+    }
+
+    prepareNnueWeights(weights);
+}
+
+template <typename T>
+static bool readValues(std::ifstream &file, std::vector<T> &values, size_t count)
+{
+    values.resize(count);
+
+    return (bool)file.read((char *)values.data(), count * sizeof(T));
+}
+
+template <typename T>
+static void writeValues(std::ofstream &file, const std::vector<T> &values)
+{
+    file.write((const char *)values.data(), values.size() * sizeof(T));
+}
+
+bool loadNnueWeights(NnueWeights &weights, const char *path)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+        return false;
+
+    NnueFileHeader header;
+    if (!file.read((char *)&header, sizeof(header)) ||
+        memcmp(header.magic, NNUE_FILE_MAGIC, 4) ||
+        (header.version != NNUE_FILE_VERSION) ||
+        (header.inputs != NNUE_INPUTS) ||
+        (header.hidden != NNUE_HIDDEN) ||
+        (header.layer != NNUE_LAYER) ||
+        (header.buckets != NNUE_BUCKETS))
+        return false;
+
+    NnueWeights values;
+    if (!readValues(file, values.featureWeights, NNUE_INPUTS * NNUE_HIDDEN) ||
+        !readValues(file, values.featureBiases, NNUE_HIDDEN) ||
+        !readValues(file, values.layerWeights, NNUE_LAYER * 2 * NNUE_HIDDEN) ||
+        !readValues(file, values.layerBiases, NNUE_LAYER) ||
+        !readValues(file, values.outputWeights, NNUE_BUCKETS * NNUE_LAYER) ||
+        !readValues(file, values.outputBiases, NNUE_BUCKETS))
+        return false;
+
+    prepareNnueWeights(values);
+    std::swap(weights, values);
+
+    return true;
+}
+
+bool saveNnueWeights(NnueWeights &weights, const char *path)
+{
+    std::ofstream file(path, std::ios::binary);
+    if (!file)
+        return false;
+
+    NnueFileHeader header;
+    memcpy(header.magic, NNUE_FILE_MAGIC, 4);
+    header.version = NNUE_FILE_VERSION;
+    header.inputs = NNUE_INPUTS;
+    header.hidden = NNUE_HIDDEN;
+    header.layer = NNUE_LAYER;
+    header.buckets = NNUE_BUCKETS;
+
+    file.write((const char *)&header, sizeof(header));
+    writeValues(file, weights.featureWeights);
+    writeValues(file, weights.featureBiases);
+    writeValues(file, weights.layerWeights);
+    writeValues(file, weights.layerBiases);
+    writeValues(file, weights.outputWeights);
+    writeValues(file, weights.outputBiases);
+
+    return (bool)file;
+}
+
+void initNnueAccumulator(NnueAccumulator &accumulator, NnueWeights &weights, GameModel &model)
+{
+    for (int side = PLAYER_BLACK; side <= PLAYER_WHITE; side++)
+    {
+        int16_t *values = accumulator.values[side];
+        uint64_t own = model.board[side];
+        uint64_t opponent = model.board[1 - side];
+
+        for (int i = 0; i < NNUE_HIDDEN; i++)
+            values[i] = weights.featureBiases[i];
+
+        for (; own; own &= own - 1)
+        {
+            const int16_t *row = &weights.featureWeights[firstBit(own) * NNUE_HIDDEN];
+            for (int i = 0; i < NNUE_HIDDEN; i++)
+                values[i] = (int16_t)(values[i] + row[i]);
+        }
+        for (; opponent; opponent &= opponent - 1)
+        {
+            int feature = BOARD_SIZE * BOARD_SIZE + firstBit(opponent);
+            const int16_t *row = &weights.featureWeights[feature * NNUE_HIDDEN];
+            for (int i = 0; i < NNUE_HIDDEN; i++)
+                values[i] = (int16_t)(values[i] + row[i]);
+        }
+    }
+}
+
+// Ficha nueva: su fila propia en el acumulador del jugador y su fila de
+// oponente en el del otro; fichas dadas vuelta: pasan de oponente a propias
+// (flipWeights) para el jugador y al revs para el otro. Las sumas de 16 bits
+// dan la vuelta, as que deshacer la jugada restaura los valores exactos
+template <int sign>
+static void updateScalar(NnueAccumulator &accumulator,
+                         NnueWeights &weights,
+                         Player player,
+                         int index,
+                         uint64_t flips)
+{
+    int16_t *own = accumulator.values[player];
+    int16_t *opponent = accumulator.values[1 - player];
+    const int16_t *placedOwn = &weights.featureWeights[index * NNUE_HIDDEN];
+    const int16_t *placedOpponent = &weights.featureWeights[(BOARD_SIZE * BOARD_SIZE + index) * NNUE_HIDDEN];
+
+    for (int i = 0; i < NNUE_HIDDEN; i++)
+    {
+        own[i] = (int16_t)(own[i] + sign * placedOwn[i]);
+        opponent[i] = (int16_t)(opponent[i] + sign * placedOpponent[i]);
+    }
+
+    for (; flips; flips &= flips - 1)
+    {
+        const int16_t *row = &weights.flipWeights[firstBit(flips) * NNUE_HIDDEN];
+        for (int i = 0; i < NNUE_HIDDEN; i++)
+        {
+            own[i] = (int16_t)(own[i] + sign * row[i]);
+            opponent[i] = (int16_t)(opponent[i] - sign * row[i]);
+        }
+    }
+}
+
+static inline int clampActivation(int value)
+{
+    return (value < 0) ? 0 : (value > NNUE_ACTIVATION_MAX) ? NNUE_ACTIVATION_MAX : value;
+}
+
+// Capa oculta: los acumuladores recortados (primero el del lado que mueve)
+// por los pesos de 8 bits, corridos y recortados
+static void evaluateLayerScalar(NnueWeights &weights,
+                                NnueAccumulator &accumulator,
+                                Player player,
+                                uint8_t *outputs)
+{
+    uint8_t inputs[2 * NNUE_HIDDEN];
+    for (int i = 0; i < NNUE_HIDDEN; i++)
+    {
+        inputs[i] = (uint8_t)clampActivation(accumulator.values[player][i]);
+        inputs[NNUE_HIDDEN + i] = (uint8_t)clampActivation(accumulator.values[1 - player][i]);
+    }
+
+    for (int j = 0; j < NNUE_LAYER; j++)
+    {
+        const int8_t *row = &weights.layerWeights[j * 2 * NNUE_HIDDEN];
+        int32_t sum = weights.layerBiases[j];
+
+        for (int i = 0; i < 2 * NNUE_HIDDEN; i++)
+            sum += inputs[i] * row[i];
+
+        outputs[j] = (uint8_t)clampActivation(sum >> NNUE_LAYER_SHIFT);
+    }
+}
+
+#if defined(NNUE_X86)
+
+#define NNUE_REGISTERS (NNUE_HIDDEN / 16)
+
+template <int sign>
+static NNUE_TARGET_AVX2 void updateAvx2(NnueAccumulator &accumulator,
+                                        NnueWeights &weights,
+                                        Player player,
+                                        int index,
+                                        uint64_t flips)
+{
+    __m256i *own = (__m256i *)accumulator.values[player];
+    __m256i *opponent = (__m256i *)accumulator.values[1 - player];
+    const __m256i *placedOwn = (const __m256i *)&weights.featureWeights[index * NNUE_HIDDEN];
+    const __m256i *placedOpponent =
+        (const __m256i *)&weights.featureWeights[(BOARD_SIZE * BOARD_SIZE + index) * NNUE_HIDDEN];
+
+    // Los acumuladores quedan en registros mientras se suman las filas
+    __m256i ownValues[NNUE_REGISTERS];
+    __m256i opponentValues[NNUE_REGISTERS];
+    for (int k = 0; k < NNUE_REGISTERS; k++)
+    {
+        __m256i ownRow = _mm256_loadu_si256(placedOwn + k);
+        __m256i opponentRow = _mm256_loadu_si256(placedOpponent + k);
+
+        ownValues[k] = _mm256_loadu_si256(own + k);
+        opponentValues[k] = _mm256_loadu_si256(opponent + k);
+        ownValues[k] = (sign > 0) ? _mm256_add_epi16(ownValues[k], ownRow) : _mm256_sub_epi16(ownValues[k], ownRow);
+        opponentValues[k] = (sign > 0) ? _mm256_add_epi16(opponentValues[k], opponentRow)
+                                       : _mm256_sub_epi16(opponentValues[k], opponentRow);
+    }
+
+    for (; flips; flips &= flips - 1)
+    {
+        const __m256i *rows = (const __m256i *)&weights.flipWeights[firstBit(flips) * NNUE_HIDDEN];
+        for (int k = 0; k < NNUE_REGISTERS; k++)
+        {
+            __m256i row = _mm256_loadu_si256(rows + k);
+
+            ownValues[k] = (sign > 0) ? _mm256_add_epi16(ownValues[k], row) : _mm256_sub_epi16(ownValues[k], row);
+            opponentValues[k] = (sign > 0) ? _mm256_sub_epi16(opponentValues[k], row)
+                                           : _mm256_add_epi16(opponentValues[k], row);
+        }
+    }
+
+    for (int k = 0; k < NNUE_REGISTERS; k++)
+    {
+        _mm256_storeu_si256(own + k, ownValues[k]);
+        _mm256_storeu_si256(opponent + k, opponentValues[k]);
+    }
+}
+
+// Recorta 32 valores de 16 bits a 0-127 y los empaqueta en bytes, en orden
+static inline NNUE_TARGET_AVX2 __m256i clampAvx2(const int16_t *values)
+{
+    __m256i low = _mm256_loadu_si256((const __m256i *)values);
+    __m256i high = _mm256_loadu_si256((const __m256i *)(values + 16));
+
+    // packs satura a -128..127 y entrelaza las mitades de 128 bits
+    __m256i packed = _mm256_max_epi8(_mm256_packs_epi16(low, high), _mm256_setzero_si256());
+
+    return _mm256_permute4x64_epi64(packed, 0xd8);
+}
+
+// Suma horizontal de cuatro vectores de 32 bits, ms el sesgo de cada uno
+static inline NNUE_TARGET_AVX2 __m128i sumAvx2(__m256i sum0, __m256i sum1, __m256i sum2, __m256i sum3, __m128i bias)
+{
+    sum0 = _mm256_hadd_epi32(sum0, sum1);
+    sum2 = _mm256_hadd_epi32(sum2, sum3);
+    sum0 = _mm256_hadd_epi32(sum0, sum2);
+
+    __m128i sum = _mm_add_epi32(_mm256_castsi256_si128(sum0), _mm256_extracti128_si256(sum0, 1));
+
+    return _mm_add_epi32(sum, bias);
+}
+
+// Producto de 32 bytes sin signo por 32 pesos con signo, en 8 sumas de 32
+// bits; las entradas de hasta 127 no saturan las sumas de a pares
+static inline NNUE_TARGET_AVX2 __m256i dotAvx2(__m256i inputs, const int8_t *weights)
+{
+    __m256i products = _mm256_maddubs_epi16(inputs, _mm256_loadu_si256((const __m256i *)weights));
+
+    return _mm256_madd_epi16(products, _mm256_set1_epi16(1));
+}
+
+#define NNUE_INPUT_REGISTERS (2 * NNUE_HIDDEN / 32)
+
+static NNUE_TARGET_AVX2 void evaluateLayerAvx2(NnueWeights &weights,
+                                               NnueAccumulator &accumulator,
+                                               Player player,
+                                               uint8_t *outputs)
+{
+    __m256i inputs[NNUE_INPUT_REGISTERS];
+    for (int k = 0; k < NNUE_INPUT_REGISTERS / 2; k++)
+    {
+        inputs[k] = clampAvx2(&accumulator.values[player][32 * k]);
+        inputs[NNUE_INPUT_REGISTERS / 2 + k] = clampAvx2(&accumulator.values[1 - player][32 * k]);
+    }
+
+    // Cuatro neuronas por vuelta, as la suma horizontal se hace una vez
+    for (int j = 0; j < NNUE_LAYER; j += 4)
+    {
+        __m256i sums[4];
+        for (int n = 0; n < 4; n++)
+        {
+            const int8_t *row = &weights.layerWeights[(j + n) * 2 * NNUE_HIDDEN];
+
+            sums[n] = dotAvx2(inputs[0], row);
+            for (int k = 1; k < NNUE_INPUT_REGISTERS; k++)
+                sums[n] = _mm256_add_epi32(sums[n], dotAvx2(inputs[k], row + 32 * k));
+        }
+
+        __m128i bias = _mm_loadu_si128((const __m128i *)&weights.layerBiases[j]);
+        __m128i sum = _mm_srai_epi32(sumAvx2(sums[0], sums[1], sums[2], sums[3], bias), NNUE_LAYER_SHIFT);
+        sum = _mm_min_epi32(_mm_max_epi32(sum, _mm_setzero_si128()), _mm_set1_epi32(NNUE_ACTIVATION_MAX));
+
+        int32_t values[4];
+        _mm_storeu_si128((__m128i *)values, sum);
+        for (int n = 0; n < 4; n++)
+            outputs[j + n] = (uint8_t)values[n];
+    }
+}
+
+#endif
+
+void updateNnueAccumulator(NnueAccumulator &accumulator,
+                           NnueWeights &weights,
+                           Player player,
+                           int index,
+                           uint64_t flips)
+{
+#if defined(NNUE_X86)
+    if (nnueBackend == BATCH_AVX2)
+    {
+        updateAvx2<1>(accumulator, weights, player, index, flips);
+        return;
+    }
+#endif
+
+    updateScalar<1>(accumulator, weights, player, index, flips);
+}
+
+void restoreNnueAccumulator(NnueAccumulator &accumulator,
+                            NnueWeights &weights,
+                            Player player,
+                            int index,
+                            uint64_t flips)
+{
+#if defined(NNUE_X86)
+    if (nnueBackend == BATCH_AVX2)
+    {
+        updateAvx2<-1>(accumulator, weights, player, index, flips);
+        return;
+    }
+#endif
+
+    updateScalar<-1>(accumulator, weights, player, index, flips);
+}
+
+int evaluateNnue(NnueWeights &weights, NnueAccumulator &accumulator, GameModel &model)
+{
+    uint8_t layer[NNUE_LAYER];
+
+#if defined(NNUE_X86)
+    if (nnueBackend == BATCH_AVX2)
+        evaluateLayerAvx2(weights, accumulator, model.currentPlayer, layer);
+    else
+#endif
+        evaluateLayerScalar(weights, accumulator, model.currentPlayer, layer);
+
+    // La salida es de una sola neurona: no vale la pena vectorizarla
+    int bucket = getEvalPhase(model);
+    const int8_t *row = &weights.outputWeights[bucket * NNUE_LAYER];
+    int32_t sum = weights.outputBiases[bucket];
+    for (int j = 0; j < NNUE_LAYER; j++)
+        sum += layer[j] * row[j];
+
+    // Redondeo a fichas enteras, dentro de los valores posibles
+    int score = (sum + ((sum >= 0) ? NNUE_OUTPUT_SCALE / 2 : -NNUE_OUTPUT_SCALE / 2)) / NNUE_OUTPUT_SCALE;
+    if (score > BOARD_SIZE * BOARD_SIZE)
+        score = BOARD_SIZE * BOARD_SIZE;
+    else if (score < -BOARD_SIZE * BOARD_SIZE)
+        score = -BOARD_SIZE * BOARD_SIZE;
+
+    return score;
+}
+
+BatchBackend getNnueBackend()
+{
+    return nnueBackend;
+}
+
+bool setNnueBackend(BatchBackend backend)
+{
+    if ((backend == BATCH_AVX512) || !isBatchBackendSupported(backend))
+        return false;
+
+    nnueBackend = backend;
+
+    return true;
+}
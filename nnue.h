@@ -0,0 +1,168 @@
+/**
+ * @brief Implements a small quantized neural network evaluation (NNUE)
+ *
+ * The input is one feature per square and disc owner, seen from each side:
+ * own discs (0-63) and opponent discs (64-127). The first layer sums the
+ * int16 weight rows of the features of each side into an accumulator, which
+ * the search updates incrementally from the placed and flipped discs of each
+ * move instead of recomputing it. Both accumulators (side to move first)
+ * are clipped to 0-127 and feed an int8 layer, whose clipped outputs feed
+ * the output of the game phase. The int8/int16 dot products use AVX2 when
+ * the CPU has it, with a scalar fallback that gives the same results.
+ *
+ * @copyright Copyright (c) 2023-2024
+ */
+
+#ifndef NNUE_H
+#define NNUE_H
+
+#include <cstdint>
+#include <vector>
+
+#include "batch.h"
+#include "eval.h"
+#include "model.h"
+
+#define NNUE_INPUTS (2 * BOARD_SIZE * BOARD_SIZE)
+#define NNUE_HIDDEN 64
+#define NNUE_LAYER 32
+#define NNUE_BUCKETS EVAL_PHASES
+
+// Outputs are in 1/NNUE_OUTPUT_SCALE of a disc
+#define NNUE_OUTPUT_SCALE 64
+
+struct NnueWeights
+{
+    // Feature rows of NNUE_HIDDEN values, and the bias of the accumulator
+    std::vector<int16_t> featureWeights;
+    std::vector<int16_t> featureBiases;
+    // Hidden layer: NNUE_LAYER rows of 2 * NNUE_HIDDEN inputs
+    std::vector<int8_t> layerWeights;
+    std::vector<int32_t> layerBiases;
+    // Output of each game phase: NNUE_LAYER inputs
+    std::vector<int8_t> outputWeights;
+    std::vector<int32_t> outputBiases;
+
+    // Change of a square from an opponent disc to an own disc (computed
+    // from the feature rows when the weights are set)
+    std::vector<int16_t> flipWeights;
+};
+
+// First layer of a position from each side, updated incrementally move by move
+struct NnueAccumulator
+{
+    int16_t values[2][NNUE_HIDDEN];
+};
+
+/**
+ * @brief Fills the weights with a network built from the heuristic of
+ * initEvalWeights.
+ *
+ * Each game phase has two neurons per side, with the positive and negative
+ * parts of the sum of the heuristic square values, read by the output of
+ * the phase, so the network estimates what the heuristic pattern weights
+ * estimate.
+ *
+ * @param weights The weights.
+ */
+void initNnueWeights(NnueWeights &weights);
+
+/**
+ * @brief Computes the flip rows of the weights from the feature rows.
+ *
+ * initNnueWeights and loadNnueWeights call it; call it again after changing
+ * the feature weights directly.
+ *
+ * @param weights The weights.
+ */
+void prepareNnueWeights(NnueWeights &weights);
+
+/**
+ * @brief Loads the weights from a binary file.
+ *
+ * The file holds a header (magic "NNUE", version, inputs, hidden, layer and
+ * bucket counts, as 32-bit integers) followed by the little-endian feature
+ * weights, feature biases, layer weights, layer biases, output weights and
+ * output biases, in the order of NnueWeights.
+ *
+ * @param weights The weights (unchanged if the file is missing or invalid).
+ * @param path The file path.
+ * @return Whether the file was loaded.
+ */
+bool loadNnueWeights(NnueWeights &weights, const char *path);
+
+/**
+ * @brief Saves the weights to a binary file (see loadNnueWeights).
+ *
+ * @param weights The weights.
+ * @param path The file path.
+ * @return Whether the file was written.
+ */
+bool saveNnueWeights(NnueWeights &weights, const char *path);
+
+/**
+ * @brief Computes the accumulators of a position from scratch.
+ *
+ * @param accumulator Receives the accumulators.
+ * @param weights The weights.
+ * @param model The position.
+ */
+void initNnueAccumulator(NnueAccumulator &accumulator, NnueWeights &weights, GameModel &model);
+
+/**
+ * @brief Updates the accumulators after a move.
+ *
+ * @param accumulator The accumulators.
+ * @param weights The weights.
+ * @param player The player who moved.
+ * @param index The bit index of the move.
+ * @param flips The flipped discs.
+ */
+void updateNnueAccumulator(NnueAccumulator &accumulator,
+                           NnueWeights &weights,
+                           Player player,
+                           int index,
+                           uint64_t flips);
+
+/**
+ * @brief Undoes updateNnueAccumulator.
+ *
+ * @param accumulator The accumulators.
+ * @param weights The weights.
+ * @param player The player who moved.
+ * @param index The bit index of the move.
+ * @param flips The flipped discs.
+ */
+void restoreNnueAccumulator(NnueAccumulator &accumulator,
+                            NnueWeights &weights,
+                            Player player,
+                            int index,
+                            uint64_t flips);
+
+/**
+ * @brief Evaluates a position with the network.
+ *
+ * @param weights The weights.
+ * @param accumulator The accumulators of the position.
+ * @param model The position.
+ * @return The estimated final disc difference for the player to move.
+ */
+int evaluateNnue(NnueWeights &weights, NnueAccumulator &accumulator, GameModel &model);
+
+/**
+ * @brief Returns the backend used by the network.
+ *
+ * @return BATCH_AVX2 if the CPU has AVX2 (AVX-512 CPUs use it too), unless
+ * the scalar backend was set.
+ */
+BatchBackend getNnueBackend();
+
+/**
+ * @brief Selects the backend of the network (for benchmarks).
+ *
+ * @param backend The backend (BATCH_SCALAR or BATCH_AVX2).
+ * @return Whether the CPU supports it (the backend is unchanged otherwise).
+ */
+bool setNnueBackend(BatchBackend backend);
+
+#endif
@@ -0,0 +1,130 @@
+/**
+ * @brief Implements a pool of search tree nodes
+ *
+ * @copyright Copyright (c) 2023-2024
+ */
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+#include "nodepool.h"
+
+static_assert(sizeof(SearchNode) == 16, "SearchNode must stay 16 bytes");
+
+// Un bloque del rbol: la raz sola, o los hijos de un nodo (inicio y cantidad)
+typedef std::pair<uint32_t, uint32_t> NodeBlock;
+
+static inline void clearNode(SearchNode &node)
+{
+    node.firstChild.store(NODE_NULL, std::memory_order_relaxed);
+    node.visits.store(0, std::memory_order_relaxed);
+    node.wins.store(0, std::memory_order_relaxed);
+    node.move = NODE_PASS_MOVE;
+    node.prior = 0;
+    node.childCount = 0;
+    node.state.store(NODE_LEAF, std::memory_order_relaxed);
+}
+
+void initNodePool(NodePool &pool, size_t megabytes)
+{
+    // Los ndices son de 32 bits (NODE_NULL queda fuera del rango)
+    uint64_t capacity = (uint64_t)megabytes * 1024 * 1024 / sizeof(SearchNode);
+    if (capacity > NODE_NULL - 1)
+        capacity = NODE_NULL - 1;
+
+    pool.nodes.reset(new SearchNode[capacity]);
+    pool.capacity = (uint32_t)capacity;
+    pool.used = 0;
+}
+
+void resetNodePool(NodePool &pool)
+{
+    pool.used = 0;
+}
+
+uint32_t allocateNodes(NodePool &pool, int count)
+{
+    // El contador nunca pasa la capacidad, as no desborda aunque muchas
+    // asignaciones fallen
+    uint32_t first = pool.used.load(std::memory_order_relaxed);
+    do
+    {
+        if ((uint64_t)first + count > pool.capacity)
+            return NODE_NULL;
+    } while (!pool.used.compare_exchange_weak(first, first + count, std::memory_order_relaxed));
+
+    for (int i = 0; i < count; i++)
+        clearNode(pool.nodes[first + i]);
+
+    return first;
+}
+
+double getNodePoolUsage(NodePool &pool)
+{
+    if (!pool.capacity)
+        return 0;
+
+    return (double)pool.used / pool.capacity;
+}
+
+uint32_t retainSubtree(NodePool &pool, uint32_t root)
+{
+    if (root == NODE_NULL)
+    {
+        resetNodePool(pool);
+        return NODE_NULL;
+    }
+
+    // Bloques del subrbol, en anchura
+    std::vector<NodeBlock> blocks;
+    blocks.push_back(NodeBlock(root, 1));
+    for (size_t i = 0; i < blocks.size(); i++)
+        for (uint32_t j = blocks[i].first; j < blocks[i].first + blocks[i].second; j++)
+        {
+            SearchNode &node = pool.nodes[j];
+            uint32_t firstChild = node.firstChild.load(std::memory_order_relaxed);
+            if (firstChild != NODE_NULL)
+                blocks.push_back(NodeBlock(firstChild, node.childCount));
+        }
+
+    // Los hijos se asignan despus que su padre, as que en el orden de la
+    // pool cada bloque va despus del bloque de su padre (y la raz primero).
+    // Compactando los bloques en ese orden, cada nodo baja (o queda) en la
+    // pool y nunca pisa uno que todava no se movi
+    std::sort(blocks.begin(), blocks.end());
+
+    std::vector<uint32_t> newStarts(blocks.size());
+    uint32_t used = 0;
+    for (size_t i = 0; i < blocks.size(); i++)
+    {
+        newStarts[i] = used;
+        used += blocks[i].second;
+    }
+
+    for (size_t i = 0; i < blocks.size(); i++)
+        for (uint32_t j = 0; j < blocks[i].second; j++)
+        {
+            SearchNode &source = pool.nodes[blocks[i].first + j];
+            SearchNode &node = pool.nodes[newStarts[i] + j];
+
+            uint32_t firstChild = source.firstChild.load(std::memory_order_relaxed);
+            if (firstChild != NODE_NULL)
+            {
+                auto block = std::lower_bound(blocks.begin(), blocks.end(), NodeBlock(firstChild, 0));
+                firstChild = newStarts[block - blocks.begin()];
+            }
+
+            node.firstChild.store(firstChild, std::memory_order_relaxed);
+            node.visits.store(source.visits.load(std::memory_order_relaxed), std::memory_order_relaxed);
+            node.wins.store(source.wins.load(std::memory_order_relaxed), std::memory_order_relaxed);
+            node.move = source.move;
+            node.prior = source.prior;
+            node.childCount = source.childCount;
+            node.state.store(source.state.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        }
+
+    pool.used = used;
+
+    return 0;
+}
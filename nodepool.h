@@ -0,0 +1,117 @@
+/**
+ * @brief Implements a pool of search tree nodes
+ *
+ * Searches that keep a tree of positions in memory (see mcts.h) take their
+ * nodes from one contiguous array allocated up front, instead of one heap
+ * allocation per node. Nodes are fixed-size and do not hold a position:
+ * the search replays the moves from the root while descending. They refer
+ * to each other by 32-bit index, and the children of a node are allocated
+ * together, so a node only stores where its children start and how many
+ * there are.
+ *
+ * Allocation bumps a shared counter, so it is lock-free and a whole tree is
+ * released in constant time by resetting the counter. The pool never grows:
+ * when it is full, allocation fails and the search stops expanding nodes.
+ * Between moves, retainSubtree keeps the subtree of the new root and
+ * recycles the rest of the pool.
+ *
+ * @copyright Copyright (c) 2023-2024
+ */
+
+#ifndef NODEPOOL_H
+#define NODEPOOL_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#define NODE_NULL 0xffffffff
+
+// Move of the only child of a position where the player must pass
+#define NODE_PASS_MOVE 0xfe
+
+// Expansion state of a node: a thread claims a leaf before allocating its
+// children, so two threads never expand the same node
+enum NodeState
+{
+    NODE_LEAF,
+    NODE_EXPANDING,
+    NODE_EXPANDED,
+};
+
+// 16 bytes: four nodes per cache line
+struct SearchNode
+{
+    // The first child, or NODE_NULL (the children follow it in the pool)
+    std::atomic<uint32_t> firstChild;
+    // Visits, counted when a search descends through the node (so searches
+    // in progress count as losses: the virtual loss of parallel searches)
+    std::atomic<uint32_t> visits;
+    // Results of the finished visits for the player who moved into the
+    // node, in half points (win 2, draw 1, loss 0)
+    std::atomic<uint32_t> wins;
+
+    // The move that leads to the node: a bit index or NODE_PASS_MOVE
+    uint8_t move;
+    // Prior probability of the move (0 to 255)
+    uint8_t prior;
+    uint8_t childCount;
+    std::atomic<uint8_t> state;
+};
+
+struct NodePool
+{
+    std::unique_ptr<SearchNode[]> nodes;
+    uint32_t capacity;
+    std::atomic<uint32_t> used;
+};
+
+/**
+ * @brief Allocates an empty pool.
+ *
+ * @param pool The pool.
+ * @param megabytes The memory budget of the pool.
+ */
+void initNodePool(NodePool &pool, size_t megabytes);
+
+/**
+ * @brief Releases all the nodes of a pool at once.
+ *
+ * @param pool The pool.
+ */
+void resetNodePool(NodePool &pool);
+
+/**
+ * @brief Allocates consecutive nodes, cleared as unvisited leaves. Safe to
+ * call from several threads at once.
+ *
+ * @param pool The pool.
+ * @param count The number of nodes.
+ * @return The index of the first node, or NODE_NULL if the pool is full.
+ */
+uint32_t allocateNodes(NodePool &pool, int count);
+
+/**
+ * @brief Returns the fraction of a pool in use.
+ *
+ * @param pool The pool.
+ * @return The fraction (0 to 1).
+ */
+double getNodePoolUsage(NodePool &pool);
+
+/**
+ * @brief Keeps the subtree of a node and releases the rest of the pool.
+ *
+ * The subtree is compacted in place to the start of the pool, keeping the
+ * children of each node together, so the search can continue from it with
+ * the rest of the pool free. Must not run during a search.
+ *
+ * @param pool The pool.
+ * @param root The index of the new root.
+ * @return The new index of the root (0), or NODE_NULL if root is NODE_NULL
+ * (the pool is then empty).
+ */
+uint32_t retainSubtree(NodePool &pool, uint32_t root);
+
+#endif
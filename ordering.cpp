@@ -0,0 +1,132 @@
+/**
+ * @brief Implements the Reversi move ordering
+ *
+ * @copyright Copyright (c) 2023-2024
+ */
+
+#include "ordering.h"
+#include "transposition.h"
+
+// Pesos de cada criterio: cada uno domina por completo a los siguientes
+#define ORDER_TT_MOVE (1 << 30)
+#define ORDER_PRIOR (1 << 20)
+#define ORDER_MOBILITY (1 << 14)
+
+// Prioridad esttica de cada casilla: 3 esquinas, 2 resto, 1 casillas C
+// (junto a una esquina sobre el borde), 0 casillas X (diagonal a una esquina)
+static const int squarePriors[BOARD_SIZE * BOARD_SIZE] = {
+    3, 1, 2, 2, 2, 2, 1, 3,
+    1, 0, 2, 2, 2, 2, 0, 1,
+    2, 2, 2, 2, 2, 2, 2, 2,
+    2, 2, 2, 2, 2, 2, 2, 2,
+    2, 2, 2, 2, 2, 2, 2, 2,
+    2, 2, 2, 2, 2, 2, 2, 2,
+    1, 0, 2, 2, 2, 2, 0, 1,
+    3, 1, 2, 2, 2, 2, 1, 3,
+};
+
+void orderMoves(MoveList &list,
+                GameModel &model,
+                uint64_t moves,
+                int ttMove,
+                HistoryTable &history,
+                bool useMobility)
+{
+    Player player = getCurrentPlayer(model);
+    Player opponent = (player == PLAYER_WHITE) ? PLAYER_BLACK : PLAYER_WHITE;
+    uint64_t playerBoard = model.board[player];
+    uint64_t opponentBoard = model.board[opponent];
+
+    list.count = 0;
+    for (; moves; moves &= moves - 1)
+    {
+        int index = firstBit(moves);
+        int score;
+
+        if (index == ttMove)
+            score = ORDER_TT_MOVE;
+        else
+        {
+            score = squarePriors[index] * ORDER_PRIOR + history.values[player][index];
+
+            // Menos respuestas del oponente despus de la jugada, mejor
+            if (useMobility)
+            {
+                uint64_t flips = getFlipsBitboard(playerBoard, opponentBoard, index);
+                uint64_t replies = getMovesBitboard(opponentBoard & ~flips,
+                                                    playerBoard | flips | squareBit(index));
+
+                score += (MAX_MOVES - countBits(replies)) * ORDER_MOBILITY;
+            }
+        }
+
+        list.moves[list.count] = index;
+        list.scores[list.count] = score;
+        list.count++;
+    }
+}
+
+int getSquarePrior(int index)
+{
+    return squarePriors[index];
+}
+
+int selectNextMove(MoveList &list, int i)
+{
+    int best = i;
+    for (int j = i + 1; j < list.count; j++)
+        if (list.scores[j] > list.scores[best])
+            best = j;
+
+    if (best != i)
+    {
+        int move = list.moves[i];
+        int score = list.scores[i];
+        list.moves[i] = list.moves[best];
+        list.scores[i] = list.scores[best];
+        list.moves[best] = move;
+        list.scores[best] = score;
+    }
+
+    return list.moves[i];
+}
+
+void clearHistory(HistoryTable &history)
+{
+    for (auto &values : history.values)
+        for (auto &value : values)
+            value = 0;
+}
+
+void ageHistory(HistoryTable &history)
+{
+    for (auto &values : history.values)
+        for (auto &value : values)
+            value /= 2;
+}
+
+void updateHistory(HistoryTable &history,
+                   OrderingStats &stats,
+                   Player player,
+                   int move,
+                   int moveNumber,
+                   int depth)
+{
+    int &value = history.values[player][move];
+
+    value += depth * depth;
+    if (value >= HISTORY_MAX)
+        value = HISTORY_MAX - 1;
+
+    stats.cutoffs++;
+    if (moveNumber == 0)
+        stats.firstMoveCutoffs++;
+}
+
+double getFirstMoveCutoffRate(OrderingStats &stats)
+{
+    if (!stats.cutoffs)
+        return 0;
+
+    return (double)stats.firstMoveCutoffs / stats.cutoffs;
+}
@@ -0,0 +1,117 @@
+/**
+ * @brief Implements the Reversi move ordering
+ *
+ * @copyright Copyright (c) 2023-2024
+ */
+
+#ifndef ORDERING_H
+#define ORDERING_H
+
+#include <cstdint>
+
+#include "model.h"
+
+#define MAX_MOVES (BOARD_SIZE * BOARD_SIZE)
+#define HISTORY_MAX (1 << 14)
+
+struct MoveList
+{
+    int count;
+    int moves[MAX_MOVES];
+    int scores[MAX_MOVES];
+};
+
+struct HistoryTable
+{
+    int values[2][BOARD_SIZE * BOARD_SIZE];
+};
+
+struct OrderingStats
+{
+    uint64_t cutoffs;
+    uint64_t firstMoveCutoffs;
+};
+
+/**
+ * @brief Scores the valid moves of a position for the search.
+ *
+ * Moves are ranked by, in order of priority: the transposition table move,
+ * the static square prior (corners first, X and C squares last), the
+ * opponent's mobility after the move (fewer replies first) and the history
+ * of cutoffs caused by the move.
+ *
+ * @param list Receives the scored moves.
+ * @param model The position.
+ * @param moves The bitboard of valid moves.
+ * @param ttMove The transposition table move, or TT_NO_MOVE.
+ * @param history The history table.
+ * @param useMobility Whether to rank by mobility (costs one move generation per move).
+ */
+void orderMoves(MoveList &list,
+                GameModel &model,
+                uint64_t moves,
+                int ttMove,
+                HistoryTable &history,
+                bool useMobility);
+
+/**
+ * @brief Returns the static priority of a square: 3 for corners, 2 for most
+ * squares, 1 for C squares and 0 for X squares.
+ *
+ * @param index The bit index of the square.
+ * @return The priority (0 to 3).
+ */
+int getSquarePrior(int index);
+
+/**
+ * @brief Returns the next best move of a list.
+ *
+ * Moves the highest-scored move in [i, count) to position i (selection sort
+ * step), so a cutoff avoids sorting the rest of the list.
+ *
+ * @param list The move list.
+ * @param i The position.
+ * @return The bit index of the move.
+ */
+int selectNextMove(MoveList &list, int i);
+
+/**
+ * @brief Clears a history table.
+ *
+ * @param history The history table.
+ */
+void clearHistory(HistoryTable &history);
+
+/**
+ * @brief Halves a history table, so recent cutoffs weigh more.
+ *
+ * @param history The history table.
+ */
+void ageHistory(HistoryTable &history);
+
+/**
+ * @brief Records a move that caused a cutoff.
+ *
+ * @param history The history table.
+ * @param stats The ordering statistics.
+ * @param player The player who made the move.
+ * @param move The bit index of the move.
+ * @param moveNumber The position of the move in the ordered list.
+ * @param depth The remaining search depth.
+ */
+void updateHistory(HistoryTable &history,
+                   OrderingStats &stats,
+                   Player player,
+                   int move,
+                   int moveNumber,
+                   int depth);
+
+/**
+ * @brief Returns the fraction of cutoffs caused by the first ordered move.
+ *
+ * @param stats The ordering statistics.
+ * @return The first-move cutoff rate (0 to 1).
+ */
+double getFirstMoveCutoffRate(OrderingStats &stats);
+
+#endif
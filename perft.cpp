@@ -0,0 +1,543 @@
+/**
+ * @brief Perft: counts the leaf nodes of the game tree to a fixed depth
+ *
+ * Walks the tree with the model's search move API from the start position
+ * and from a set of fixed positions, on the 8x8 and 6x6 boards, checks the
+ * counts against known reference values and prints nodes/sec. A pass counts
+ * as a ply, and a finished game counts as a single leaf.
+ *
+ * With --check, instead of counting, plays seeded random games and checks
+ * that the incremental and vectorized versions of the search functions
+ * give the same results as their reference versions (see the checks below).
+ *
+ * Usage: perft [--depth N] [--size 6|8]
+ *        perft --check [--games N]
+ *
+ * The exit code is nonzero if any count or check differs from its reference.
+ *
+ * @copyright Copyright (c) 2023-2024
+ */
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+
+#include "batch.h"
+#include "eval.h"
+#include "model.h"
+#include "nnue.h"
+#include "nodepool.h"
+
+#define PERFT_MAX_DEPTH 11
+
+// Partidas al azar de --check
+#define CHECK_DEFAULT_GAMES 200
+// Expansiones de cada rbol al azar del chequeo de retainSubtree
+#define CHECK_TREE_EXPANSIONS 200
+
+struct PerftPosition
+{
+    const char *name;
+    int size;
+    // Jugadas desde la posicin inicial ("f5d6c3")
+    const char *moves;
+    int depth;
+    uint64_t counts[PERFT_MAX_DEPTH];
+};
+
+// Valores de referencia: la posicin inicial de 8x8 coincide con los valores
+// publicados; las dems se verificaron con el modelo original (sin bitboards)
+// o, en 6x6, con un generador de jugadas sobre una matriz de casillas
+static const PerftPosition perftPositions[] = {
+    {"start",
+     8,
+     "",
+     9,
+     {4, 12, 56, 244, 1396, 8200, 55092, 390216, 3005288, 24571284, 212258800}},
+    {"midgame",
+     8,
+     "c4c5e6c3b5f7d6c6c7e7d3c8b3a2a3e2e3c2d1f3",
+     5,
+     {16, 157, 2276, 22237, 317197, 3245243}},
+    {"endgame (passes)",
+     8,
+     "c4c3c2d6f6f3d7b4b3d8f4f5b5d3e2a4a5f1a3f7e3d2c5b6e6a6g4a2g2f2a7c7g5d1g7h1e7a8b1h5b7b2a1g8f8c1",
+     7,
+     {8, 60, 478, 2939, 21129, 110093, 674535, 2875612}},
+    {"6x6 start",
+     6,
+     "",
+     9,
+     {4, 12, 56, 244, 1364, 7604, 47740, 308716, 2114912}},
+    {"6x6 endgame",
+     6,
+     "d5c5b2e2b6e4e5d6e3d2c1f5e1a1b5c6b3a6a3f1",
+     11,
+     {3, 18, 68, 423, 1448, 7976, 24162, 101451, 241962, 632192, 912729}},
+};
+
+template <int Size>
+static bool setupPosition(BoardModel<Size> &model, const char *moves)
+{
+    startModel(model);
+
+    for (const char *move = moves; move[0] && move[1]; move += 2)
+        if (!playMove(model, {move[0] - 'a', move[1] - '1'}))
+            return false;
+
+    return true;
+}
+
+template <int Size>
+static uint64_t perft(BoardModel<Size> &model, int depth, bool passed)
+{
+    if (!depth)
+        return 1;
+
+    // Sin jugadas: pasa, salvo que el oponente acabe de pasar (fin del juego)
+    uint64_t moves = getValidMovesBitboard(model);
+    if (!moves)
+    {
+        if (passed)
+            return 1;
+
+        makePass(model);
+        uint64_t nodes = perft(model, depth - 1, true);
+        makePass(model);
+
+        return nodes;
+    }
+
+    uint64_t nodes = 0;
+    for (; moves; moves &= moves - 1)
+    {
+        int index = firstBit(moves);
+
+        uint64_t flips = makeMove(model, index);
+        nodes += perft(model, depth - 1, false);
+        unmakeMove(model, index, flips);
+    }
+
+    return nodes;
+}
+
+// Cuenta las hojas de una posicin a cada profundidad y las compara con
+// las referencias; devuelve false si las jugadas de la posicin son invlidas
+template <int Size>
+static bool runPosition(const PerftPosition &position,
+                        int maxDepth,
+                        bool &passed,
+                        uint64_t &totalNodes,
+                        double &totalSeconds)
+{
+    BoardModel<Size> model;
+    if (!setupPosition(model, position.moves))
+    {
+        std::cerr << position.name << ": invalid moves" << std::endl;
+        return false;
+    }
+
+    std::cout << position.name << std::endl;
+
+    int depth = maxDepth ? maxDepth : position.depth;
+    for (int d = 1; d <= depth; d++)
+    {
+        auto start = std::chrono::steady_clock::now();
+        uint64_t nodes = perft(model, d, false);
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        totalNodes += nodes;
+        totalSeconds += seconds;
+
+        std::cout << "  depth " << std::setw(2) << d
+                  << " " << std::setw(12) << nodes
+                  << " " << std::fixed << std::setprecision(3) << std::setw(8) << seconds << " s"
+                  << " " << std::setprecision(0) << std::setw(12) << (seconds > 0 ? nodes / seconds : 0) << " nodes/s";
+
+        // Las referencias que faltan (--depth mayor) no se verifican
+        int references = 0;
+        while ((references < PERFT_MAX_DEPTH) && position.counts[references])
+            references++;
+        if (d <= references)
+        {
+            bool match = (nodes == position.counts[d - 1]);
+            std::cout << (match ? "  ok" : "  MISMATCH, expected ")
+                      << (match ? "" : std::to_string(position.counts[d - 1]));
+            passed = passed && match;
+        }
+        std::cout << std::endl;
+    }
+
+    return true;
+}
+
+// Juega partidas al azar con semilla fija; antes de cada jugada llama a
+// visit con la posicin, la jugada elegida y si es la primera de la partida
+template <typename Visit>
+static void playCheckGames(int games, Visit visit)
+{
+    std::mt19937_64 random(1);
+
+    for (int game = 0; game < games; game++)
+    {
+        GameModel model;
+        startModel(model);
+
+        for (bool start = true; !model.gameOver; start = false)
+        {
+            Moves validMoves;
+            getValidMoves(model, validMoves);
+            Square move = validMoves[random() % validMoves.size()];
+
+            visit(model, getSquareIndex(move), start);
+            playMove(model, move);
+        }
+    }
+}
+
+static bool reportCheck(const std::string &name, uint64_t cases, uint64_t mismatches)
+{
+    std::cout << std::left << std::setw(40) << name << std::right << std::setw(10) << cases << " cases"
+              << (mismatches ? "  MISMATCH: " + std::to_string(mismatches) : std::string("  ok")) << std::endl;
+
+    return !mismatches;
+}
+
+// ndices de los patrones: actualizados jugada a jugada durante toda la
+// partida, iguales a los calculados desde cero, y restaurados al deshacer
+static bool checkEvalState(int games)
+{
+    EvalState state;
+    uint64_t cases = 0;
+    uint64_t mismatches = 0;
+
+    playCheckGames(games, [&](GameModel &model, int index, bool start) {
+        if (start)
+            initEvalState(state, model);
+
+        Player player = model.currentPlayer;
+        GameModel next = model;
+        uint64_t flips = makeMove(next, index);
+
+        EvalState previous = state;
+        updateEvalState(state, player, index, flips);
+        restoreEvalState(state, player, index, flips);
+        mismatches += memcmp(&state, &previous, sizeof(state)) != 0;
+
+        EvalState expected;
+        updateEvalState(state, player, index, flips);
+        initEvalState(expected, next);
+        mismatches += memcmp(&state, &expected, sizeof(state)) != 0;
+        cases++;
+    });
+
+    return reportCheck("updateEvalState", cases, mismatches);
+}
+
+// Copia los primeros count tableros de un lote
+static void copyBatchPrefix(const BoardBatch &boards, size_t count, BoardBatch &prefix)
+{
+    prefix.player.assign(boards.player.begin(), boards.player.begin() + count);
+    prefix.opponent.assign(boards.opponent.begin(), boards.opponent.begin() + count);
+}
+
+// Funciones por lotes: cada conjunto de instrucciones contra el escalar,
+// con jugadas vlidas e invlidas, y con lotes chicos para probar los
+// tableros que no llenan un vector
+static bool checkBatch(int games)
+{
+    BoardBatch boards;
+    std::vector<uint8_t> moves;
+    std::mt19937_64 random(2);
+
+    playCheckGames(games, [&](GameModel &model, int index, bool start) {
+        addBatchBoard(boards, model);
+        moves.push_back((random() % 4) ? (uint8_t)index : (uint8_t)(random() % 64));
+    });
+
+    BatchBackend defaultBackend = getBatchBackend();
+    bool passed = true;
+
+    for (int backend = BATCH_AVX2; backend <= BATCH_AVX512; backend++)
+    {
+        if (!isBatchBackendSupported((BatchBackend)backend))
+            continue;
+
+        uint64_t cases = 0;
+        uint64_t moveMismatches = 0;
+        uint64_t boardMismatches = 0;
+
+        for (size_t count = 1; count <= boards.player.size(); count = (count < 16) ? count + 1 : boards.player.size())
+        {
+            BoardBatch batch;
+            copyBatchPrefix(boards, count, batch);
+            std::vector<uint8_t> batchMoves(moves.begin(), moves.begin() + count);
+
+            std::vector<uint64_t> expectedMoves;
+            BoardBatch expectedBoards;
+            setBatchBackend(BATCH_SCALAR);
+            getMovesBatch(batch, expectedMoves);
+            makeMovesBatch(batch, batchMoves, expectedBoards);
+
+            std::vector<uint64_t> validMoves;
+            BoardBatch nextBoards;
+            setBatchBackend((BatchBackend)backend);
+            getMovesBatch(batch, validMoves);
+            makeMovesBatch(batch, batchMoves, nextBoards);
+
+            for (size_t i = 0; i < count; i++)
+            {
+                moveMismatches += validMoves[i] != expectedMoves[i];
+                boardMismatches += (nextBoards.player[i] != expectedBoards.player[i]) ||
+                                   (nextBoards.opponent[i] != expectedBoards.opponent[i]);
+            }
+            cases += count;
+
+            if (count == boards.player.size())
+                break;
+        }
+
+        std::string suffix = std::string(" (") + getBatchBackendName((BatchBackend)backend) + ")";
+        passed = reportCheck("getMovesBatch" + suffix, cases, moveMismatches) && passed;
+        passed = reportCheck("makeMovesBatch" + suffix, cases, boardMismatches) && passed;
+    }
+
+    setBatchBackend(defaultBackend);
+
+    return passed;
+}
+
+// Recorre un subrbol en profundidad y anota los campos de cada nodo
+static void serializeSubtree(NodePool &pool, uint32_t index, std::vector<uint64_t> &fields)
+{
+    SearchNode &node = pool.nodes[index];
+    uint32_t firstChild = node.firstChild.load();
+
+    fields.push_back(node.visits.load());
+    fields.push_back(node.wins.load());
+    fields.push_back(node.move | (node.prior << 8) | (node.childCount << 16) | (node.state.load() << 24));
+    fields.push_back(firstChild == NODE_NULL);
+
+    if (firstChild != NODE_NULL)
+        for (int i = 0; i < node.childCount; i++)
+            serializeSubtree(pool, firstChild + i, fields);
+}
+
+// Compactacin de la pool de nodos: el subrbol de un nodo al azar de un
+// rbol al azar queda al principio de la pool, con los mismos campos
+static bool checkRetainSubtree(int games)
+{
+    NodePool pool;
+    initNodePool(pool, 1);
+    std::mt19937_64 random(3);
+    uint64_t cases = 0;
+    uint64_t mismatches = 0;
+
+    for (int tree = 0; tree < games; tree++)
+    {
+        resetNodePool(pool);
+        std::vector<uint32_t> leaves(1, allocateNodes(pool, 1));
+        pool.nodes[0].move = NODE_PASS_MOVE;
+
+        // Expande hojas al azar, as los hijos de cada nodo quedan
+        // mezclados en la pool con los de otras ramas
+        for (int i = 0; (i < CHECK_TREE_EXPANSIONS) && !leaves.empty(); i++)
+        {
+            size_t leaf = random() % leaves.size();
+            SearchNode &node = pool.nodes[leaves[leaf]];
+            int childCount = 1 + random() % 8;
+            uint32_t firstChild = allocateNodes(pool, childCount);
+            if (firstChild == NODE_NULL)
+                break;
+
+            node.firstChild = firstChild;
+            node.childCount = childCount;
+            node.state = NODE_EXPANDED;
+            leaves[leaf] = leaves.back();
+            leaves.pop_back();
+
+            for (int j = 0; j < childCount; j++)
+            {
+                SearchNode &child = pool.nodes[firstChild + j];
+                child.move = random() % 64;
+                child.prior = random() % 256;
+                child.visits = random() % 1000;
+                child.wins = random() % 2000;
+                child.state = (random() % 4) ? NODE_LEAF : NODE_EXPANDING;
+                leaves.push_back(firstChild + j);
+            }
+        }
+
+        // Nueva raz: baja al azar desde la raz, a veces hasta una hoja
+        uint32_t root = 0;
+        while ((pool.nodes[root].firstChild != NODE_NULL) && (random() % 4))
+            root = pool.nodes[root].firstChild + random() % pool.nodes[root].childCount;
+
+        std::vector<uint64_t> expected;
+        serializeSubtree(pool, root, expected);
+
+        std::vector<uint64_t> fields;
+        uint32_t newRoot = retainSubtree(pool, root);
+        if (newRoot == 0)
+            serializeSubtree(pool, newRoot, fields);
+
+        mismatches += (newRoot != 0) || (pool.used != expected.size() / 4) || (fields != expected);
+        cases++;
+    }
+
+    mismatches += (retainSubtree(pool, NODE_NULL) != NODE_NULL) || (pool.used != 0);
+    cases++;
+
+    return reportCheck("retainSubtree", cases, mismatches);
+}
+
+// Red neuronal con pesos al azar: en cada conjunto de instrucciones, el
+// acumulador incremental igual al calculado desde cero, restaurado al
+// deshacer, y la evaluacin igual a la escalar
+static bool checkNnue(int games)
+{
+    NnueWeights weights;
+    std::mt19937_64 random(4);
+    auto randomValue = [&](int range) { return (int)(random() % (2 * range)) - range; };
+
+    weights.featureWeights.resize(NNUE_INPUTS * NNUE_HIDDEN);
+    for (int16_t &value : weights.featureWeights)
+        value = (int16_t)randomValue(16);
+    weights.featureBiases.resize(NNUE_HIDDEN);
+    for (int16_t &value : weights.featureBiases)
+        value = (int16_t)randomValue(64);
+    weights.layerWeights.resize(NNUE_LAYER * 2 * NNUE_HIDDEN);
+    for (int8_t &value : weights.layerWeights)
+        value = (int8_t)randomValue(128);
+    weights.layerBiases.resize(NNUE_LAYER);
+    for (int32_t &value : weights.layerBiases)
+        value = randomValue(4096);
+    weights.outputWeights.resize(NNUE_BUCKETS * NNUE_LAYER);
+    for (int8_t &value : weights.outputWeights)
+        value = (int8_t)randomValue(8);
+    weights.outputBiases.resize(NNUE_BUCKETS);
+    for (int32_t &value : weights.outputBiases)
+        value = randomValue(1024);
+    prepareNnueWeights(weights);
+
+    BatchBackend defaultBackend = getNnueBackend();
+    NnueAccumulator accumulators[BATCH_AVX2 + 1];
+    uint64_t cases = 0;
+    uint64_t accumulatorMismatches[BATCH_AVX2 + 1] = {};
+    uint64_t scoreMismatches[BATCH_AVX2 + 1] = {};
+
+    playCheckGames(games, [&](GameModel &model, int index, bool start) {
+        Player player = model.currentPlayer;
+        GameModel next = model;
+        uint64_t flips = makeMove(next, index);
+
+        setNnueBackend(BATCH_SCALAR);
+        NnueAccumulator expected;
+        initNnueAccumulator(expected, weights, next);
+        int expectedScore = evaluateNnue(weights, expected, next);
+
+        for (int backend = BATCH_SCALAR; backend <= BATCH_AVX2; backend++)
+        {
+            if (!setNnueBackend((BatchBackend)backend))
+                continue;
+
+            NnueAccumulator &accumulator = accumulators[backend];
+            if (start)
+                initNnueAccumulator(accumulator, weights, model);
+
+            NnueAccumulator previous = accumulator;
+            updateNnueAccumulator(accumulator, weights, player, index, flips);
+            restoreNnueAccumulator(accumulator, weights, player, index, flips);
+            accumulatorMismatches[backend] += memcmp(&accumulator, &previous, sizeof(accumulator)) != 0;
+
+            updateNnueAccumulator(accumulator, weights, player, index, flips);
+            accumulatorMismatches[backend] += memcmp(&accumulator, &expected, sizeof(accumulator)) != 0;
+            scoreMismatches[backend] += evaluateNnue(weights, accumulator, next) != expectedScore;
+        }
+        cases++;
+    });
+
+    setNnueBackend(defaultBackend);
+
+    bool passed = true;
+
+    for (int backend = BATCH_SCALAR; backend <= BATCH_AVX2; backend++)
+    {
+        if (!isBatchBackendSupported((BatchBackend)backend))
+            continue;
+
+        std::string suffix = std::string(" (") + getBatchBackendName((BatchBackend)backend) + ")";
+        passed = reportCheck("updateNnueAccumulator" + suffix, cases, accumulatorMismatches[backend]) && passed;
+        passed = reportCheck("evaluateNnue" + suffix, cases, scoreMismatches[backend]) && passed;
+    }
+
+    return passed;
+}
+
+static bool runChecks(int games)
+{
+    bool passed = true;
+
+    passed = checkEvalState(games) && passed;
+    passed = checkBatch(games) && passed;
+    passed = checkRetainSubtree(games) && passed;
+    passed = checkNnue(games) && passed;
+
+    return passed;
+}
+
+int main(int argc, char *argv[])
+{
+    int maxDepth = 0;
+    int size = 0;
+    bool check = false;
+    int games = CHECK_DEFAULT_GAMES;
+
+    for (int i = 1; i < argc; i++)
+    {
+        std::string option = argv[i];
+
+        if ((option == "--depth") && (i + 1 < argc))
+            maxDepth = std::atoi(argv[++i]);
+        else if ((option == "--size") && (i + 1 < argc))
+            size = std::atoi(argv[++i]);
+        else if (option == "--check")
+            check = true;
+        else if ((option == "--games") && (i + 1 < argc))
+            games = std::atoi(argv[++i]);
+        else
+        {
+            std::cerr << "Usage: perft [--depth N] [--size 6|8]" << std::endl
+                      << "       perft --check [--games N]" << std::endl;
+            return 1;
+        }
+    }
+
+    if (check)
+        return runChecks(games) ? 0 : 1;
+
+    bool passed = true;
+    uint64_t totalNodes = 0;
+    double totalSeconds = 0;
+
+    for (auto &position : perftPositions)
+    {
+        if (size && (position.size != size))
+            continue;
+
+        bool valid = (position.size == 6)
+                         ? runPosition<6>(position, maxDepth, passed, totalNodes, totalSeconds)
+                         : runPosition<8>(position, maxDepth, passed, totalNodes, totalSeconds);
+        if (!valid)
+            return 1;
+    }
+
+    std::cout << "Total: " << totalNodes << " nodes, " << std::setprecision(0)
+              << (totalSeconds > 0 ? totalNodes / totalSeconds : 0) << " nodes/s" << std::endl;
+
+    return passed ? 0 : 1;
+}
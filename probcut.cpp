@@ -0,0 +1,268 @@
+/**
+ * @brief Implements Multi-ProbCut selective search parameters
+ *
+ * @copyright Copyright (c) 2023-2024
+ */
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+
+#include "probcut.h"
+
+#define PROBCUT_FILE_MAGIC "PCUT"
+#define PROBCUT_FILE_VERSION 1
+
+struct ProbCutFileHeader
+{
+    char magic[4];
+    uint32_t version;
+    uint32_t phases;
+    uint32_t maxDepth;
+    uint32_t checks;
+};
+
+// Umbral de confianza de cada nivel, en desvos estndar
+static const float probCutThresholds[PROBCUT_LEVELS] = {0.0F, 2.6F, 2.0F, 1.5F, 1.1F};
+
+// Regresiones ajustadas con probcutfit sobre los pesos heursticos:
+// pendiente, ordenada y desvo, por fase, profundidad y chequeo
+static const float builtInRegressions[EVAL_PHASES][PROBCUT_MAX_DEPTH + 1][PROBCUT_CHECKS][3] = {
+    {
+        {{0.000F, 0.000F, 0.000F}, {0.000F, 0.000F, 0.000F}},
+        {{0.000F, 0.000F, 0.000F}, {0.000F, 0.000F, 0.000F}},
+        {{0.000F, 0.000F, 0.000F}, {0.000F, 0.000F, 0.000F}},
+        {{0.735F, 0.042F, 0.549F}, {0.000F, 0.000F, 0.000F}},
+        {{1.055F, 0.041F, 0.549F}, {0.000F, 0.000F, 0.000F}},
+        {{0.844F, 0.305F, 0.775F}, {1.048F, 0.263F, 0.865F}},
+        {{1.108F, 0.048F, 0.949F}, {0.000F, 0.000F, 0.000F}},
+        {{0.792F, 0.374F, 0.740F}, {0.949F, 0.337F, 0.919F}},
+        {{1.015F, 0.035F, 1.033F}, {1.022F, 0.002F, 0.642F}},
+        {{0.859F, 0.471F, 0.673F}, {0.944F, 0.185F, 0.583F}},
+        {{1.069F, -0.191F, 1.058F}, {1.046F, -0.229F, 0.769F}},
+        {{0.959F, 0.801F, 0.605F}, {1.030F, 0.490F, 0.627F}},
+        {{1.193F, -0.341F, 1.177F}, {1.057F, -0.394F, 0.715F}},
+        {{0.909F, 0.603F, 1.054F}, {1.114F, 0.188F, 0.792F}},
+        {{1.305F, -0.459F, 1.293F}, {1.172F, -0.516F, 0.694F}},
+    },
+    {
+        {{0.000F, 0.000F, 0.000F}, {0.000F, 0.000F, 0.000F}},
+        {{0.000F, 0.000F, 0.000F}, {0.000F, 0.000F, 0.000F}},
+        {{0.000F, 0.000F, 0.000F}, {0.000F, 0.000F, 0.000F}},
+        {{1.072F, 0.491F, 2.106F}, {0.000F, 0.000F, 0.000F}},
+        {{1.051F, 0.578F, 2.242F}, {0.000F, 0.000F, 0.000F}},
+        {{1.129F, 0.790F, 2.489F}, {1.041F, 0.256F, 1.360F}},
+        {{1.160F, 0.559F, 2.609F}, {0.000F, 0.000F, 0.000F}},
+        {{1.173F, 0.833F, 2.802F}, {1.097F, 0.299F, 1.553F}},
+        {{1.229F, 0.569F, 3.267F}, {1.190F, -0.045F, 1.587F}},
+        {{1.347F, 0.935F, 3.409F}, {1.196F, -0.004F, 1.616F}},
+        {{1.295F, 0.232F, 3.529F}, {1.235F, -0.470F, 2.148F}},
+        {{1.477F, 1.027F, 3.721F}, {1.287F, -0.032F, 2.180F}},
+        {{1.469F, 0.041F, 3.974F}, {1.268F, -0.663F, 2.182F}},
+        {{1.691F, 1.298F, 4.355F}, {1.432F, 0.085F, 1.881F}},
+        {{1.604F, 0.047F, 4.267F}, {1.369F, -0.773F, 2.535F}},
+    },
+    {
+        {{0.000F, 0.000F, 0.000F}, {0.000F, 0.000F, 0.000F}},
+        {{0.000F, 0.000F, 0.000F}, {0.000F, 0.000F, 0.000F}},
+        {{0.000F, 0.000F, 0.000F}, {0.000F, 0.000F, 0.000F}},
+        {{1.055F, 0.209F, 1.677F}, {0.000F, 0.000F, 0.000F}},
+        {{1.059F, 0.180F, 1.615F}, {0.000F, 0.000F, 0.000F}},
+        {{1.087F, 0.545F, 2.166F}, {1.029F, 0.335F, 1.384F}},
+        {{1.113F, -0.069F, 2.382F}, {0.000F, 0.000F, 0.000F}},
+        {{1.191F, 0.489F, 3.036F}, {1.134F, 0.232F, 2.200F}},
+        {{1.192F, -0.240F, 2.877F}, {1.131F, -0.448F, 1.986F}},
+        {{1.242F, 0.250F, 3.680F}, {1.161F, -0.464F, 1.970F}},
+        {{1.308F, -0.144F, 3.953F}, {1.247F, -0.380F, 2.994F}},
+        {{1.323F, 0.285F, 4.586F}, {1.243F, -0.506F, 2.972F}},
+        {{1.388F, -0.549F, 4.735F}, {1.265F, -0.481F, 2.961F}},
+        {{1.374F, 0.080F, 5.663F}, {1.184F, -0.647F, 3.520F}},
+        {{1.487F, -1.138F, 6.310F}, {1.379F, -1.087F, 4.235F}},
+    },
+    {
+        {{0.000F, 0.000F, 0.000F}, {0.000F, 0.000F, 0.000F}},
+        {{0.000F, 0.000F, 0.000F}, {0.000F, 0.000F, 0.000F}},
+        {{0.000F, 0.000F, 0.000F}, {0.000F, 0.000F, 0.000F}},
+        {{1.057F, 0.224F, 2.184F}, {0.000F, 0.000F, 0.000F}},
+        {{1.034F, -0.154F, 1.908F}, {0.000F, 0.000F, 0.000F}},
+        {{1.061F, 0.840F, 2.735F}, {1.005F, 0.606F, 1.472F}},
+        {{1.020F, 0.507F, 3.474F}, {0.000F, 0.000F, 0.000F}},
+        {{1.128F, 1.614F, 4.005F}, {1.077F, 1.324F, 2.795F}},
+        {{1.030F, 0.278F, 4.519F}, {1.017F, 0.442F, 3.228F}},
+        {{1.172F, 1.435F, 4.978F}, {1.119F, 0.423F, 3.352F}},
+        {{1.092F, 0.200F, 6.182F}, {1.082F, 0.377F, 5.061F}},
+        {{1.158F, 1.671F, 6.053F}, {1.115F, 0.613F, 4.512F}},
+        {{1.079F, 0.196F, 7.256F}, {1.101F, -0.347F, 4.992F}},
+        {{1.076F, 3.034F, 7.515F}, {1.007F, 1.117F, 4.948F}},
+        {{1.142F, 0.319F, 8.540F}, {1.184F, -0.258F, 5.897F}},
+    },
+    {
+        {{0.000F, 0.000F, 0.000F}, {0.000F, 0.000F, 0.000F}},
+        {{0.000F, 0.000F, 0.000F}, {0.000F, 0.000F, 0.000F}},
+        {{0.000F, 0.000F, 0.000F}, {0.000F, 0.000F, 0.000F}},
+        {{0.992F, 0.613F, 3.800F}, {0.000F, 0.000F, 0.000F}},
+        {{1.031F, 0.904F, 3.544F}, {0.000F, 0.000F, 0.000F}},
+        {{0.939F, 1.771F, 7.967F}, {0.996F, 1.077F, 5.495F}},
+        {{0.978F, 1.476F, 7.575F}, {0.000F, 0.000F, 0.000F}},
+        {{0.901F, 2.635F, 10.128F}, {0.974F, 1.926F, 8.029F}},
+        {{0.948F, 2.578F, 11.828F}, {1.004F, 2.153F, 9.605F}},
+        {{0.865F, 4.230F, 13.744F}, {1.076F, 2.079F, 7.810F}},
+        {{0.880F, 4.370F, 14.478F}, {0.947F, 4.045F, 12.741F}},
+        {{0.821F, 5.104F, 15.617F}, {1.075F, 2.882F, 10.087F}},
+        {{0.889F, 7.152F, 16.338F}, {1.116F, 6.623F, 10.704F}},
+        {{0.836F, 6.979F, 17.675F}, {1.167F, 3.536F, 9.527F}},
+        {{0.844F, 9.734F, 18.521F}, {1.119F, 9.467F, 13.164F}},
+    },
+    {
+        {{0.000F, 0.000F, 0.000F}, {0.000F, 0.000F, 0.000F}},
+        {{0.000F, 0.000F, 0.000F}, {0.000F, 0.000F, 0.000F}},
+        {{0.000F, 0.000F, 0.000F}, {0.000F, 0.000F, 0.000F}},
+        {{1.022F, 0.155F, 6.502F}, {0.000F, 0.000F, 0.000F}},
+        {{0.991F, 1.221F, 4.737F}, {0.000F, 0.000F, 0.000F}},
+        {{0.942F, 0.193F, 10.603F}, {0.986F, -0.294F, 6.026F}},
+        {{0.919F, 3.346F, 9.724F}, {0.000F, 0.000F, 0.000F}},
+        {{0.962F, -0.911F, 13.718F}, {1.026F, -1.505F, 9.830F}},
+        {{0.952F, 4.428F, 11.369F}, {1.019F, 3.272F, 8.124F}},
+        {{0.974F, -1.370F, 14.561F}, {1.113F, -1.956F, 5.697F}},
+        {{0.969F, 4.986F, 11.984F}, {1.039F, 3.810F, 8.767F}},
+        {{0.974F, -1.370F, 14.561F}, {1.113F, -1.956F, 5.697F}},
+        {{0.969F, 4.986F, 11.984F}, {1.077F, 1.416F, 4.455F}},
+        {{0.974F, -1.370F, 14.561F}, {1.023F, -0.492F, 3.041F}},
+        {{0.969F, 4.986F, 11.984F}, {1.077F, 1.416F, 4.455F}},
+    },
+};
+
+void initProbCutParams(ProbCutParams &params)
+{
+    for (int phase = 0; phase < EVAL_PHASES; phase++)
+        for (int depth = 0; depth <= PROBCUT_MAX_DEPTH; depth++)
+            for (int check = 0; check < PROBCUT_CHECKS; check++)
+            {
+                ProbCutRegression &regression = params.regressions[phase][depth][check];
+                const float *values = builtInRegressions[phase][depth][check];
+
+                regression.slope = values[0];
+                regression.intercept = values[1];
+                regression.sigma = values[2];
+            }
+}
+
+bool loadProbCutParams(ProbCutParams &params, const char *path)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+        return false;
+
+    ProbCutFileHeader header;
+    if (!file.read((char *)&header, sizeof(header)) ||
+        memcmp(header.magic, PROBCUT_FILE_MAGIC, 4) ||
+        (header.version != PROBCUT_FILE_VERSION) ||
+        (header.phases != EVAL_PHASES) ||
+        (header.maxDepth != PROBCUT_MAX_DEPTH) ||
+        (header.checks != PROBCUT_CHECKS))
+        return false;
+
+    ProbCutParams values;
+    if (!file.read((char *)values.regressions, sizeof(values.regressions)))
+        return false;
+
+    params = values;
+
+    return true;
+}
+
+bool saveProbCutParams(ProbCutParams &params, const char *path)
+{
+    std::ofstream file(path, std::ios::binary);
+    if (!file)
+        return false;
+
+    ProbCutFileHeader header;
+    memcpy(header.magic, PROBCUT_FILE_MAGIC, 4);
+    header.version = PROBCUT_FILE_VERSION;
+    header.phases = EVAL_PHASES;
+    header.maxDepth = PROBCUT_MAX_DEPTH;
+    header.checks = PROBCUT_CHECKS;
+
+    file.write((const char *)&header, sizeof(header));
+    file.write((const char *)params.regressions, sizeof(params.regressions));
+
+    return (bool)file;
+}
+
+int getProbCutDepth(int depth, int check)
+{
+    if ((depth < PROBCUT_MIN_DEPTH) || (depth > PROBCUT_MAX_DEPTH))
+        return -1;
+
+    // Primero un chequeo barato de una o dos jugadas; despus, desde
+    // profundidad 5, uno de la mitad de la profundidad
+    int cheapDepth = (depth & 1) ? 1 : 2;
+    if (check == 0)
+        return cheapDepth;
+
+    int shallowDepth = 2 * (depth / 4) + (depth & 1);
+    if ((check == 1) && (shallowDepth > cheapDepth))
+        return shallowDepth;
+
+    return -1;
+}
+
+float getProbCutThreshold(int selectivity)
+{
+    if ((selectivity < 0) || (selectivity >= PROBCUT_LEVELS))
+        return 0.0F;
+
+    return probCutThresholds[selectivity];
+}
+
+void fitProbCutRegression(const std::vector<int> &shallowScores,
+                          const std::vector<int> &deepScores,
+                          ProbCutRegression &regression)
+{
+    regression.slope = 1.0F;
+    regression.intercept = 0.0F;
+    regression.sigma = 0.0F;
+
+    size_t count = shallowScores.size();
+    if (count < 2)
+        return;
+
+    double meanShallow = 0;
+    double meanDeep = 0;
+    for (size_t i = 0; i < count; i++)
+    {
+        meanShallow += shallowScores[i];
+        meanDeep += deepScores[i];
+    }
+    meanShallow /= count;
+    meanDeep /= count;
+
+    double covariance = 0;
+    double variance = 0;
+    for (size_t i = 0; i < count; i++)
+    {
+        covariance += (shallowScores[i] - meanShallow) * (deepScores[i] - meanDeep);
+        variance += (shallowScores[i] - meanShallow) * (shallowScores[i] - meanShallow);
+    }
+
+    // Sin variacin en la bsqueda corta no hay pendiente que ajustar
+    double slope = (variance > 0) ? covariance / variance : 1.0;
+    double intercept = meanDeep - slope * meanShallow;
+
+    double squaredError = 0;
+    for (size_t i = 0; i < count; i++)
+    {
+        double error = deepScores[i] - (slope * shallowScores[i] + intercept);
+        squaredError += error * error;
+    }
+
+    regression.slope = (float)slope;
+    regression.intercept = (float)intercept;
+    regression.sigma = (float)std::sqrt(squaredError / (count - 1));
+
+    // Un desvo nulo desactivara el chequeo: se deja al menos media ficha
+    if (regression.sigma < 0.5F)
+        regression.sigma = 0.5F;
+}
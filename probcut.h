@@ -0,0 +1,107 @@
+/**
+ * @brief Implements Multi-ProbCut selective search parameters
+ *
+ * A deep search value v is predicted from a shallow search value v' by a
+ * linear regression v = slope * v' + intercept, with a normal error of
+ * standard deviation sigma. When the shallow search shows that v is at
+ * least beta (or at most alpha) with enough confidence, the deep search is
+ * cut without being done. There is one regression per game phase, deep
+ * depth and check: each deep depth is tried against up to PROBCUT_CHECKS
+ * shallow depths, the cheapest first.
+ *
+ * @copyright Copyright (c) 2023-2024
+ */
+
+#ifndef PROBCUT_H
+#define PROBCUT_H
+
+#include <vector>
+
+#include "eval.h"
+#include "model.h"
+
+// Deep depths with regressions
+#define PROBCUT_MIN_DEPTH 3
+#define PROBCUT_MAX_DEPTH 14
+
+#define PROBCUT_CHECKS 2
+
+// Selectivity levels: 0 searches full width, higher levels cut more
+#define PROBCUT_LEVELS 5
+#define PROBCUT_DEFAULT_SELECTIVITY 2
+
+struct ProbCutRegression
+{
+    float slope;
+    float intercept;
+    // Zero if the regression was not fitted (the check is skipped)
+    float sigma;
+};
+
+struct ProbCutParams
+{
+    ProbCutRegression regressions[EVAL_PHASES][PROBCUT_MAX_DEPTH + 1][PROBCUT_CHECKS];
+};
+
+/**
+ * @brief Fills the parameters with the built-in table, fitted offline with
+ * the probcutfit tool on the built-in evaluation weights.
+ *
+ * @param params The parameters.
+ */
+void initProbCutParams(ProbCutParams &params);
+
+/**
+ * @brief Loads the parameters from a binary file.
+ *
+ * The file holds a header (magic "PCUT", version, phase count, maximum
+ * depth and check count, as 32-bit integers) followed by the slope,
+ * intercept and sigma of every regression, as 32-bit floats.
+ *
+ * @param params The parameters (unchanged if the file is missing or invalid).
+ * @param path The file path.
+ * @return Whether the file was loaded.
+ */
+bool loadProbCutParams(ProbCutParams &params, const char *path);
+
+/**
+ * @brief Saves the parameters to a binary file (see loadProbCutParams).
+ *
+ * @param params The parameters.
+ * @param path The file path.
+ * @return Whether the file was written.
+ */
+bool saveProbCutParams(ProbCutParams &params, const char *path);
+
+/**
+ * @brief Returns the shallow depth of a check.
+ *
+ * Shallow depths keep the parity of the deep depth, since the side that
+ * moves last biases the evaluation.
+ *
+ * @param depth The deep depth.
+ * @param check The check (0 to PROBCUT_CHECKS - 1).
+ * @return The shallow depth, or -1 if the check is not used at that depth.
+ */
+int getProbCutDepth(int depth, int check);
+
+/**
+ * @brief Returns the confidence threshold of a selectivity level.
+ *
+ * @param selectivity The level (0 to PROBCUT_LEVELS - 1).
+ * @return The threshold, in standard deviations (0 if ProbCut is off).
+ */
+float getProbCutThreshold(int selectivity);
+
+/**
+ * @brief Fits a regression by least squares.
+ *
+ * @param shallowScores The shallow search values.
+ * @param deepScores The deep search values of the same positions.
+ * @param regression Receives the regression (sigma is zero without data).
+ */
+void fitProbCutRegression(const std::vector<int> &shallowScores,
+                          const std::vector<int> &deepScores,
+                          ProbCutRegression &regression);
+
+#endif
@@ -0,0 +1,313 @@
+/**
+ * @brief Fits the Multi-ProbCut parameters
+ *
+ * Samples positions of every game phase from self-play games (greedy on the
+ * evaluation, with random moves), searches each one full width at every
+ * depth up to the maximum, and fits, for each phase, deep depth and check,
+ * the regression of the deep value on the shallow value. Writes the
+ * parameters file and prints them as the built-in table of probcut.cpp.
+ *
+ * Usage: probcutfit [--output FILE] [--positions N] [--depth N]
+ *                   [--weights FILE] [--network FILE] [--concurrency N]
+ *                   [--hash MB] [--seed N]
+ *
+ * With --network, the searches evaluate with that neural network (see
+ * nnue.h), so the parameters fit the network evaluation.
+ *
+ * @copyright Copyright (c) 2023-2024
+ */
+
+#include <atomic>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ai.h"
+#include "probcut.h"
+
+// Probabilidad de una jugada al azar en las partidas de muestra
+#define RANDOM_MOVE_RATE 0.3
+
+struct FitConfig
+{
+    const char *outputPath;
+    int positions;
+    int maxDepth;
+    const char *weightsPath;
+    const char *networkPath;
+    int concurrency;
+    size_t hashSize;
+    uint64_t seed;
+};
+
+// Posicin de muestra con los valores de la bsqueda a cada profundidad
+struct Sample
+{
+    GameModel model;
+    int phase;
+    std::vector<int> scores;
+};
+
+static AIEngine *createFitEngine(FitConfig &config)
+{
+    AIEngine *engine = createEngine();
+    setHashSize(*engine, config.hashSize);
+    setSelectivity(*engine, 0);
+    if (config.weightsPath)
+        setEvalWeights(*engine, config.weightsPath);
+    if (config.networkPath)
+    {
+        setEvalNetwork(*engine, config.networkPath);
+        setEvalMode(*engine, EVAL_NETWORK);
+    }
+
+    return engine;
+}
+
+// Juega partidas hasta tener la cantidad pedida de posiciones de cada fase,
+// tomando a lo sumo una posicin por fase de cada partida
+static void samplePositions(FitConfig &config, AIEngine &engine, std::vector<Sample> &samples)
+{
+    std::mt19937_64 random(config.seed);
+    std::uniform_real_distribution<double> uniform(0, 1);
+
+    std::vector<int> phaseCounts(EVAL_PHASES, 0);
+    int pendingPhases = EVAL_PHASES;
+
+    while (pendingPhases)
+    {
+        GameModel model;
+        startModel(model);
+
+        std::vector<std::vector<GameModel>> gamePositions(EVAL_PHASES);
+        while (!model.gameOver)
+        {
+            gamePositions[getEvalPhase(model)].push_back(model);
+
+            Moves validMoves;
+            getValidMoves(model, validMoves);
+
+            Square move = validMoves[random() % validMoves.size()];
+            if (uniform(random) >= RANDOM_MOVE_RATE)
+            {
+                int bestValue = 0;
+                for (size_t i = 0; i < validMoves.size(); i++)
+                {
+                    GameModel child = model;
+                    playMove(child, validMoves[i]);
+
+                    int value = (child.currentPlayer == model.currentPlayer)
+                                    ? getSearchScore(engine, child, 0)
+                                    : -getSearchScore(engine, child, 0);
+                    if ((i == 0) || (value > bestValue))
+                    {
+                        bestValue = value;
+                        move = validMoves[i];
+                    }
+                }
+            }
+
+            playMove(model, move);
+        }
+
+        for (int phase = 0; phase < EVAL_PHASES; phase++)
+        {
+            std::vector<GameModel> &positions = gamePositions[phase];
+            if (positions.empty() || (phaseCounts[phase] >= config.positions))
+                continue;
+
+            Sample sample;
+            sample.model = positions[random() % positions.size()];
+            sample.phase = phase;
+            samples.push_back(sample);
+
+            if (++phaseCounts[phase] == config.positions)
+                pendingPhases--;
+        }
+    }
+}
+
+// Cada hilo toma posiciones hasta que no quedan
+static void searchWorker(FitConfig &config,
+                         std::vector<Sample> &samples,
+                         std::atomic<size_t> &nextSample,
+                         std::mutex &outputMutex)
+{
+    AIEngine *engine = createFitEngine(config);
+
+    for (size_t i = nextSample++; i < samples.size(); i = nextSample++)
+    {
+        Sample &sample = samples[i];
+        for (int depth = 0; depth <= config.maxDepth; depth++)
+            sample.scores.push_back(getSearchScore(*engine, sample.model, depth));
+
+        if (((i + 1) % 10) == 0)
+        {
+            std::lock_guard<std::mutex> lock(outputMutex);
+            std::cerr << "Searched " << i + 1 << "/" << samples.size() << " positions" << std::endl;
+        }
+    }
+
+    freeEngine(engine);
+}
+
+static void fitParams(FitConfig &config, std::vector<Sample> &samples, ProbCutParams &params)
+{
+    for (int phase = 0; phase < EVAL_PHASES; phase++)
+        for (int depth = 0; depth <= PROBCUT_MAX_DEPTH; depth++)
+            for (int check = 0; check < PROBCUT_CHECKS; check++)
+            {
+                ProbCutRegression &regression = params.regressions[phase][depth][check];
+                regression = ProbCutRegression();
+
+                int shallowDepth = getProbCutDepth(depth, check);
+                if ((shallowDepth < 0) || (depth > config.maxDepth))
+                    continue;
+
+                std::vector<int> shallowScores;
+                std::vector<int> deepScores;
+                for (auto &sample : samples)
+                    if (sample.phase == phase)
+                    {
+                        shallowScores.push_back(sample.scores[shallowDepth]);
+                        deepScores.push_back(sample.scores[depth]);
+                    }
+
+                fitProbCutRegression(shallowScores, deepScores, regression);
+            }
+}
+
+static void printParams(ProbCutParams &params)
+{
+    std::cout << std::fixed << std::setprecision(3);
+    for (int phase = 0; phase < EVAL_PHASES; phase++)
+    {
+        std::cout << "    {" << std::endl;
+        for (int depth = 0; depth <= PROBCUT_MAX_DEPTH; depth++)
+        {
+            std::cout << "        {";
+            for (int check = 0; check < PROBCUT_CHECKS; check++)
+            {
+                ProbCutRegression &regression = params.regressions[phase][depth][check];
+                std::cout << (check ? ", " : "") << "{"
+                          << regression.slope << "F, "
+                          << regression.intercept << "F, "
+                          << regression.sigma << "F}";
+            }
+            std::cout << "}," << std::endl;
+        }
+        std::cout << "    }," << std::endl;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    FitConfig config;
+    config.outputPath = "probcut.bin";
+    config.positions = 200;
+    config.maxDepth = PROBCUT_MAX_DEPTH;
+    config.weightsPath = nullptr;
+    config.networkPath = nullptr;
+    config.concurrency = (int)std::thread::hardware_concurrency();
+    config.hashSize = 16;
+    config.seed = 1;
+
+    for (int i = 1; i < argc; i++)
+    {
+        std::string option = argv[i];
+        const char *value = (i + 1 < argc) ? argv[++i] : nullptr;
+
+        if (!value)
+        {
+            std::cerr << "Missing value for " << option << std::endl;
+            return 1;
+        }
+
+        if (option == "--output")
+            config.outputPath = value;
+        else if (option == "--positions")
+            config.positions = std::atoi(value);
+        else if (option == "--depth")
+            config.maxDepth = std::atoi(value);
+        else if (option == "--weights")
+            config.weightsPath = value;
+        else if (option == "--network")
+            config.networkPath = value;
+        else if (option == "--concurrency")
+            config.concurrency = std::atoi(value);
+        else if (option == "--hash")
+            config.hashSize = (size_t)std::atoi(value);
+        else if (option == "--seed")
+            config.seed = std::strtoull(value, nullptr, 10);
+        else
+        {
+            std::cerr << "Unknown option " << option << std::endl;
+            return 1;
+        }
+    }
+
+    if (config.positions < 2)
+        config.positions = 2;
+    if (config.maxDepth > PROBCUT_MAX_DEPTH)
+        config.maxDepth = PROBCUT_MAX_DEPTH;
+    if (config.concurrency < 1)
+        config.concurrency = 1;
+
+    if (config.weightsPath)
+    {
+        AIEngine *engine = createEngine();
+        bool loaded = setEvalWeights(*engine, config.weightsPath);
+        freeEngine(engine);
+        if (!loaded)
+        {
+            std::cerr << "Could not read weights from " << config.weightsPath << std::endl;
+            return 1;
+        }
+    }
+    if (config.networkPath)
+    {
+        AIEngine *engine = createEngine();
+        bool loaded = setEvalNetwork(*engine, config.networkPath);
+        freeEngine(engine);
+        if (!loaded)
+        {
+            std::cerr << "Could not read network from " << config.networkPath << std::endl;
+            return 1;
+        }
+    }
+
+    std::vector<Sample> samples;
+    AIEngine *engine = createFitEngine(config);
+    samplePositions(config, *engine, samples);
+    freeEngine(engine);
+
+    std::atomic<size_t> nextSample(0);
+    std::mutex outputMutex;
+    std::vector<std::thread> workers;
+    for (int i = 0; i < config.concurrency; i++)
+        workers.push_back(std::thread(searchWorker,
+                                      std::ref(config),
+                                      std::ref(samples),
+                                      std::ref(nextSample),
+                                      std::ref(outputMutex)));
+    for (auto &worker : workers)
+        worker.join();
+
+    ProbCutParams params;
+    fitParams(config, samples, params);
+    printParams(params);
+
+    if (!saveProbCutParams(params, config.outputPath))
+    {
+        std::cerr << "Could not write " << config.outputPath << std::endl;
+        return 1;
+    }
+    std::cerr << "Wrote " << config.outputPath << std::endl;
+
+    return 0;
+}
@@ -0,0 +1,149 @@
+/**
+ * @brief Symmetries of the 8x8 Reversi board
+ *
+ * A position and its 8 reflections and rotations play the same, so the
+ * opening book and the position cache store each position once, in its
+ * canonical form: the smallest of its 8 symmetries.
+ *
+ * @copyright Copyright (c) 2023-2024
+ */
+
+#ifndef SYMMETRY_H
+#define SYMMETRY_H
+
+#include <cstdint>
+
+#include "bitboard.h"
+
+#define BOARD_SYMMETRIES 8
+
+/**
+ * @brief Mirrors a bitboard horizontally (reverses the files).
+ *
+ * @param bitboard The bitboard.
+ * @return The mirrored bitboard.
+ */
+inline uint64_t mirrorBitboard(uint64_t bitboard)
+{
+    bitboard = ((bitboard >> 1) & 0x5555555555555555ULL) | ((bitboard & 0x5555555555555555ULL) << 1);
+    bitboard = ((bitboard >> 2) & 0x3333333333333333ULL) | ((bitboard & 0x3333333333333333ULL) << 2);
+    return ((bitboard >> 4) & 0x0f0f0f0f0f0f0f0fULL) | ((bitboard & 0x0f0f0f0f0f0f0f0fULL) << 4);
+}
+
+/**
+ * @brief Flips a bitboard vertically (reverses the rows).
+ *
+ * @param bitboard The bitboard.
+ * @return The flipped bitboard.
+ */
+inline uint64_t flipBitboard(uint64_t bitboard)
+{
+    bitboard = ((bitboard >> 8) & 0x00ff00ff00ff00ffULL) | ((bitboard & 0x00ff00ff00ff00ffULL) << 8);
+    bitboard = ((bitboard >> 16) & 0x0000ffff0000ffffULL) | ((bitboard & 0x0000ffff0000ffffULL) << 16);
+    return (bitboard >> 32) | (bitboard << 32);
+}
+
+/**
+ * @brief Transposes a bitboard (swaps files and rows).
+ *
+ * @param bitboard The bitboard.
+ * @return The transposed bitboard.
+ */
+inline uint64_t transposeBitboard(uint64_t bitboard)
+{
+    uint64_t t;
+
+    t = 0x0f0f0f0f00000000ULL & (bitboard ^ (bitboard << 28));
+    bitboard ^= t ^ (t >> 28);
+    t = 0x3333000033330000ULL & (bitboard ^ (bitboard << 14));
+    bitboard ^= t ^ (t >> 14);
+    t = 0x5500550055005500ULL & (bitboard ^ (bitboard << 7));
+    bitboard ^= t ^ (t >> 7);
+
+    return bitboard;
+}
+
+/**
+ * @brief Applies a symmetry to a bitboard.
+ *
+ * As in the evaluation, bit 0 of the symmetry mirrors the files, bit 1
+ * flips the rows and bit 2 transposes (after the reflections).
+ *
+ * @param bitboard The bitboard.
+ * @param symmetry The symmetry (0 to BOARD_SYMMETRIES - 1).
+ * @return The transformed bitboard.
+ */
+inline uint64_t transformBitboard(uint64_t bitboard, int symmetry)
+{
+    if (symmetry & 1)
+        bitboard = mirrorBitboard(bitboard);
+    if (symmetry & 2)
+        bitboard = flipBitboard(bitboard);
+    if (symmetry & 4)
+        bitboard = transposeBitboard(bitboard);
+
+    return bitboard;
+}
+
+/**
+ * @brief Applies a symmetry to a square.
+ *
+ * @param index The bit index of the square.
+ * @param symmetry The symmetry.
+ * @return The bit index of the transformed square.
+ */
+inline int transformIndex(int index, int symmetry)
+{
+    return firstBit(transformBitboard(squareBit(index), symmetry));
+}
+
+/**
+ * @brief Returns the symmetry that undoes another.
+ *
+ * Without a transposition each reflection is its own inverse; with one,
+ * the reflections swap files and rows.
+ *
+ * @param symmetry The symmetry.
+ * @return The inverse symmetry.
+ */
+inline int getInverseSymmetry(int symmetry)
+{
+    if (!(symmetry & 4))
+        return symmetry;
+
+    return 4 | ((symmetry & 1) << 1) | ((symmetry & 2) >> 1);
+}
+
+/**
+ * @brief Converts a position to its canonical form.
+ *
+ * @param player The bitboard of the player to move (replaced).
+ * @param opponent The bitboard of the opponent (replaced).
+ * @return The symmetry that takes the position to its canonical form.
+ */
+inline int canonicalizePosition(uint64_t &player, uint64_t &opponent)
+{
+    uint64_t bestPlayer = player;
+    uint64_t bestOpponent = opponent;
+    int bestSymmetry = 0;
+
+    for (int symmetry = 1; symmetry < BOARD_SYMMETRIES; symmetry++)
+    {
+        uint64_t p = transformBitboard(player, symmetry);
+        uint64_t o = transformBitboard(opponent, symmetry);
+
+        if ((p < bestPlayer) || ((p == bestPlayer) && (o < bestOpponent)))
+        {
+            bestPlayer = p;
+            bestOpponent = o;
+            bestSymmetry = symmetry;
+        }
+    }
+
+    player = bestPlayer;
+    opponent = bestOpponent;
+
+    return bestSymmetry;
+}
+
+#endif
@@ -0,0 +1,154 @@
+/**
+ * @brief Implements the Reversi transposition table
+ *
+ * @copyright Copyright (c) 2023-2024
+ */
+
+#include "transposition.h"
+
+// Empaquetado de una entrada en 64 bits:
+// puntaje (16) | profundidad (8) | cota (8) | mejor jugada (8) | edad (8)
+#define DATA_EMPTY 0
+
+static inline uint64_t packEntry(int score, int depth, Bound bound, int bestMove, uint8_t age)
+{
+    return (uint64_t)(uint16_t)score |
+           ((uint64_t)(uint8_t)(depth + 1) << 16) |
+           ((uint64_t)bound << 24) |
+           ((uint64_t)(uint8_t)bestMove << 32) |
+           ((uint64_t)age << 40);
+}
+
+// La profundidad se guarda desplazada en uno: cero indica una entrada vaca
+static inline int getDataDepth(uint64_t data)
+{
+    return (int)((data >> 16) & 0xff) - 1;
+}
+
+static inline uint8_t getDataAge(uint64_t data)
+{
+    return (uint8_t)(data >> 40);
+}
+
+static inline void unpackEntry(uint64_t data, TTEntry &entry)
+{
+    entry.score = (int16_t)(data & 0xffff);
+    entry.depth = getDataDepth(data);
+    entry.bound = (Bound)((data >> 24) & 0xff);
+    entry.bestMove = (int)((data >> 32) & 0xff);
+}
+
+void initTranspositionTable(TranspositionTable &table, size_t megabytes)
+{
+    // Cantidad de buckets: la mayor potencia de dos que entra en el tamao pedido
+    size_t bucketCount = 1;
+    while (bucketCount * 2 * sizeof(TTBucket) <= megabytes * 1024 * 1024)
+        bucketCount *= 2;
+
+    table.buckets.reset(new TTBucket[bucketCount]);
+    table.bucketMask = bucketCount - 1;
+
+    clearTranspositionTable(table);
+}
+
+void clearTranspositionTable(TranspositionTable &table)
+{
+    for (uint64_t i = 0; table.buckets && (i <= table.bucketMask); i++)
+        for (auto &slot : table.buckets[i].slots)
+        {
+            slot.check.store(0, std::memory_order_relaxed);
+            slot.data.store(DATA_EMPTY, std::memory_order_relaxed);
+        }
+
+    table.age = 0;
+}
+
+void ageTranspositionTable(TranspositionTable &table)
+{
+    table.age++;
+}
+
+bool probeTranspositionTable(TranspositionTable &table,
+                             uint64_t key,
+                             TTEntry &entry,
+                             TTStats &stats)
+{
+    TTBucket &bucket = table.buckets[key & table.bucketMask];
+
+    stats.probes++;
+
+    for (auto &slot : bucket.slots)
+    {
+        uint64_t data = slot.data.load(std::memory_order_relaxed);
+        uint64_t check = slot.check.load(std::memory_order_relaxed);
+
+        if (((check ^ data) == key) && (data != DATA_EMPTY))
+        {
+            unpackEntry(data, entry);
+
+            // La posicin sigue en juego: se renueva su edad, as las ramas
+            // de la bsqueda anterior que la partida sigui no se reemplazan
+            // antes que las que abandon
+            if (getDataAge(data) != table.age)
+            {
+                data = packEntry(entry.score, entry.depth, entry.bound, entry.bestMove, table.age);
+                slot.data.store(data, std::memory_order_relaxed);
+                slot.check.store(key ^ data, std::memory_order_relaxed);
+            }
+
+            stats.hits++;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void storeTranspositionTable(TranspositionTable &table,
+                             uint64_t key,
+                             int depth,
+                             Bound bound,
+                             int score,
+                             int bestMove)
+{
+    TTBucket &bucket = table.buckets[key & table.bucketMask];
+    TTSlot *replace = &bucket.slots[0];
+    int replaceValue = 0;
+
+    for (int i = 0; i < TT_BUCKET_SIZE; i++)
+    {
+        TTSlot &slot = bucket.slots[i];
+        uint64_t data = slot.data.load(std::memory_order_relaxed);
+        uint64_t check = slot.check.load(std::memory_order_relaxed);
+
+        if ((check ^ data) == key)
+        {
+            // Conserva la mejor jugada conocida si la nueva bsqueda no tiene
+            if ((bestMove == TT_NO_MOVE) && (data != DATA_EMPTY))
+                bestMove = (int)((data >> 32) & 0xff);
+
+            replace = &slot;
+            break;
+        }
+
+        // Reemplaza la entrada de la bsqueda ms vieja y, a igual edad, la menos profunda
+        int value = getDataDepth(data) - 8 * (uint8_t)(table.age - getDataAge(data));
+        if ((i == 0) || (value < replaceValue))
+        {
+            replace = &slot;
+            replaceValue = value;
+        }
+    }
+
+    uint64_t data = packEntry(score, depth, bound, bestMove, table.age);
+    replace->data.store(data, std::memory_order_relaxed);
+    replace->check.store(key ^ data, std::memory_order_relaxed);
+}
+
+double getTranspositionHitRate(TTStats &stats)
+{
+    if (!stats.probes)
+        return 0;
+
+    return (double)stats.hits / stats.probes;
+}
@@ -0,0 +1,127 @@
+/**
+ * @brief Implements the Reversi transposition table
+ *
+ * @copyright Copyright (c) 2023-2024
+ */
+
+#ifndef TRANSPOSITION_H
+#define TRANSPOSITION_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#define TT_BUCKET_SIZE 4
+#define TT_NO_MOVE 0xff
+
+enum Bound
+{
+    BOUND_UPPER,
+    BOUND_LOWER,
+    BOUND_EXACT,
+};
+
+struct TTEntry
+{
+    int score;
+    int depth;
+    Bound bound;
+    int bestMove;
+};
+
+// Lock-free slot: the entry is packed into one word, and the key is stored
+// XORed with it, so a torn write from another thread fails verification
+struct TTSlot
+{
+    std::atomic<uint64_t> check;
+    std::atomic<uint64_t> data;
+};
+
+// A bucket fills one 64-byte cache line
+struct TTBucket
+{
+    TTSlot slots[TT_BUCKET_SIZE];
+};
+
+struct TranspositionTable
+{
+    std::unique_ptr<TTBucket[]> buckets;
+    uint64_t bucketMask;
+    uint8_t age;
+};
+
+struct TTStats
+{
+    uint64_t probes;
+    uint64_t hits;
+};
+
+/**
+ * @brief Allocates and clears a transposition table.
+ *
+ * @param table The transposition table.
+ * @param megabytes The table size, rounded down to a power of two of buckets.
+ */
+void initTranspositionTable(TranspositionTable &table, size_t megabytes);
+
+/**
+ * @brief Clears all entries of a transposition table.
+ *
+ * @param table The transposition table.
+ */
+void clearTranspositionTable(TranspositionTable &table);
+
+/**
+ * @brief Marks the start of a new search, so older entries are replaced first.
+ *
+ * @param table The transposition table.
+ */
+void ageTranspositionTable(TranspositionTable &table);
+
+/**
+ * @brief Looks up a position. Safe to call from several threads at once.
+ *
+ * A found entry of an older search is renewed to the current one, so the
+ * positions the game still reaches outlive the rest of the older searches.
+ *
+ * @param table The transposition table.
+ * @param key The Zobrist hash of the position.
+ * @param entry Receives the entry if found.
+ * @param stats The caller's probe statistics.
+ * @return Whether the position was found.
+ */
+bool probeTranspositionTable(TranspositionTable &table,
+                             uint64_t key,
+                             TTEntry &entry,
+                             TTStats &stats);
+
+/**
+ * @brief Stores a search result. Safe to call from several threads at once.
+ *
+ * Replaces the entry of the same position if present, otherwise the entry of
+ * the bucket with the oldest and shallowest search.
+ *
+ * @param table The transposition table.
+ * @param key The Zobrist hash of the position.
+ * @param depth The searched depth.
+ * @param bound The bound type of the score.
+ * @param score The score.
+ * @param bestMove The bit index of the best move, or TT_NO_MOVE.
+ */
+void storeTranspositionTable(TranspositionTable &table,
+                             uint64_t key,
+                             int depth,
+                             Bound bound,
+                             int score,
+                             int bestMove);
+
+/**
+ * @brief Returns the fraction of probes that found their position.
+ *
+ * @param stats The probe statistics.
+ * @return The hit rate (0 to 1).
+ */
+double getTranspositionHitRate(TTStats &stats);
+
+#endif
@@ -9,8 +9,10 @@
 
 #include "raylib.h"
 
+#include "ai.h"
 #include "controller.h"
 #include "model.h"
+#include "view.h"
 
 #define GAME_NAME "EDAversi"
 
@@ -48,6 +50,11 @@
 #define INFO_BLACK_SCORE_Y (WINDOW_HEIGHT * 3 / 4 - SUBTITLE_FONT_SIZE / 2)
 #define INFO_BLACK_TIME_Y (WINDOW_HEIGHT * 3 / 4 + SUBTITLE_FONT_SIZE / 2)
 
+#define INFO_STATS_FONT_SIZE 18
+#define INFO_STATS_LINE_HEIGHT 20
+#define INFO_STATS_Y (INFO_TITLE_Y + TITLE_FONT_SIZE / 2 + INFO_STATS_LINE_HEIGHT)
+#define INFO_STATS_PV_MOVES 8
+
 #define INFO_BUTTON_WIDTH 280
 #define INFO_BUTTON_HEIGHT 64
 
@@ -57,15 +64,62 @@
 #define INFO_PLAYWHITE_BUTTON_X INFO_CENTERED_X
 #define INFO_PLAYWHITE_BUTTON_Y (WINDOW_HEIGHT * 7 / 8)
 
+#define ACTIVE_FPS 60
+
+// Sin cambios ni entrada durante IDLE_DELAY segundos, la vista baja a
+// IDLE_FPS; a 20 cuadros por segundo un clic (unos 100 ms) todava abarca
+// al menos un cuadro, as que no se pierde
+#define IDLE_FPS 20
+#define IDLE_DELAY 2.0
+
+// Lo que muestra la capa del cuadro: slo se vuelve a dibujar si cambia
+struct FrameState
+{
+    uint64_t board[2];
+    bool gameOver;
+    int blackSeconds;
+    int whiteSeconds;
+
+    bool showStats;
+    uint64_t statsNodes;
+    int statsDepth;
+    int statsScore;
+    double statsSeconds;
+};
+
+// Capa fija (fondo, tablero vaco y ttulo), dibujada una sola vez, y capa
+// del cuadro (la capa fija ms fichas y textos)
+static RenderTexture2D boardLayer;
+static RenderTexture2D frameLayer;
+
+static FrameState frameState;
+static bool frameValid = false;
+
+static bool idle = false;
+static double lastActivityTime = 0;
+
+static void renderBoardLayer();
+
 void initView()
 {
     InitWindow(WINDOW_WIDTH, WINDOW_HEIGHT, GAME_NAME);
 
-    SetTargetFPS(60);
+    SetTargetFPS(ACTIVE_FPS);
+
+    boardLayer = LoadRenderTexture(WINDOW_WIDTH, WINDOW_HEIGHT);
+    frameLayer = LoadRenderTexture(WINDOW_WIDTH, WINDOW_HEIGHT);
+    renderBoardLayer();
+
+    frameValid = false;
+    idle = false;
+    lastActivityTime = GetTime();
 }
 
 void freeView()
 {
+    UnloadRenderTexture(frameLayer);
+    UnloadRenderTexture(boardLayer);
+
     CloseWindow();
 }
 
@@ -129,6 +183,66 @@ static void drawTimer(Vector2 position,
     drawCenteredText(position, SUBTITLE_FONT_SIZE, s);
 }
 
+/**
+ * @brief Returns a percentage as text.
+ *
+ * @param part The part.
+ * @param total The total.
+ * @return The percentage ("0%" if the total is zero).
+ */
+static std::string getPercentText(double part, double total)
+{
+    int percent = (total > 0) ? (int)(100 * part / total + 0.5) : 0;
+
+    return std::to_string(percent) + "%";
+}
+
+/**
+ * @brief Draws the statistics of the AI's last search.
+ *
+ * @param stats The statistics.
+ */
+static void drawSearchStats(const SearchStats &stats)
+{
+    std::string lines[5];
+
+    lines[0] = "Depth " + std::to_string(stats.depth) + "/" +
+               std::to_string(stats.selectiveDepth) + "  Score " +
+               ((stats.score > 0) ? "+" : "") + std::to_string(stats.score) +
+               (stats.book ? "  (book)" : "");
+
+    int tenthsOfMillion = (int)(stats.nodesPerSecond / 100000);
+    lines[1] = "Nodes " + std::to_string(stats.nodes) + "  " +
+               std::to_string(tenthsOfMillion / 10) + "." +
+               std::to_string(tenthsOfMillion % 10) + " M/s";
+
+    lines[2] = "PV";
+    for (size_t i = 0; (i < stats.principalVariation.size()) && (i < INFO_STATS_PV_MOVES); i++)
+    {
+        Square move = stats.principalVariation[i];
+        lines[2] += " ";
+        lines[2] += (char)('a' + move.x);
+        lines[2] += (char)('1' + move.y);
+    }
+
+    lines[3] = "Hash " + getPercentText((double)stats.hashHits, (double)stats.hashProbes) +
+               "  First cutoff " + getPercentText((double)stats.firstMoveCutoffs, (double)stats.cutoffs) +
+               "  ProbCut " + std::to_string(stats.probCutCuts);
+
+    double total = stats.moveGenSeconds + stats.evalSeconds +
+                   stats.endgameSeconds + stats.searchSeconds;
+    lines[4] = "Gen " + getPercentText(stats.moveGenSeconds, total) +
+               "  Eval " + getPercentText(stats.evalSeconds, total) +
+               "  Search " + getPercentText(stats.searchSeconds, total) +
+               "  Endgame " + getPercentText(stats.endgameSeconds, total);
+
+    for (int i = 0; i < 5; i++)
+        drawCenteredText({INFO_CENTERED_X,
+                          (float)(INFO_STATS_Y + i * INFO_STATS_LINE_HEIGHT)},
+                         INFO_STATS_FONT_SIZE,
+                         lines[i]);
+}
+
 /**
  * @brief Draws a button.
  *
@@ -166,9 +280,26 @@ static bool isMousePointerOverButton(Vector2 position)
             (mousePosition.y < (position.y + INFO_BUTTON_HEIGHT / 2)));
 }
 
-void drawView(GameModel &model)
+/**
+ * @brief Draws a render texture over the whole window.
+ *
+ * @param layer The render texture.
+ */
+static void drawLayer(RenderTexture2D &layer)
 {
-    BeginDrawing();
+    // Las texturas de render quedan invertidas verticalmente
+    DrawTextureRec(layer.texture,
+                   {0, 0, (float)WINDOW_WIDTH, -(float)WINDOW_HEIGHT},
+                   {0, 0},
+                   WHITE);
+}
+
+/**
+ * @brief Draws the static layer: background, empty board and title.
+ */
+static void renderBoardLayer()
+{
+    BeginTextureMode(boardLayer);
 
     ClearBackground(BEIGE);
 
@@ -181,27 +312,43 @@ void drawView(GameModel &model)
 
     for (int y = 0; y < BOARD_SIZE; y++)
         for (int x = 0; x < BOARD_SIZE; x++)
-        {
-            Square square = {x, y};
-
-            Vector2 position = {
-                BOARD_X + (float)square.x * SQUARE_SIZE,
-                BOARD_Y + (float)square.y * SQUARE_SIZE};
-
             DrawRectangleRounded(
-                {position.x + SQUARE_CONTENT_OFFSET,
-                 position.y + SQUARE_CONTENT_OFFSET,
+                {BOARD_X + (float)x * SQUARE_SIZE + SQUARE_CONTENT_OFFSET,
+                 BOARD_Y + (float)y * SQUARE_SIZE + SQUARE_CONTENT_OFFSET,
                  SQUARE_CONTENT_SIZE,
                  SQUARE_CONTENT_SIZE},
                 0.2F,
                 6,
                 DARKGREEN);
 
-            Piece piece = getBoardPiece(model, square);
+    drawCenteredText({INFO_CENTERED_X,
+                      INFO_TITLE_Y},
+                     TITLE_FONT_SIZE,
+                     GAME_NAME);
+
+    EndTextureMode();
+}
+
+/**
+ * @brief Draws the frame layer: the static layer, pieces and labels.
+ *
+ * @param model The game model.
+ * @param stats The search statistics, or nullptr.
+ */
+static void renderFrameLayer(GameModel &model, const SearchStats *stats)
+{
+    BeginTextureMode(frameLayer);
+
+    drawLayer(boardLayer);
+
+    for (int y = 0; y < BOARD_SIZE; y++)
+        for (int x = 0; x < BOARD_SIZE; x++)
+        {
+            Piece piece = getBoardPiece(model, {x, y});
 
             if (piece != PIECE_EMPTY)
-                DrawCircle((int)position.x + PIECE_CENTER,
-                           (int)position.y + PIECE_CENTER,
+                DrawCircle(BOARD_X + x * SQUARE_SIZE + PIECE_CENTER,
+                           BOARD_Y + y * SQUARE_SIZE + PIECE_CENTER,
                            PIECE_RADIUS,
                            (piece == PIECE_WHITE) ? WHITE : BLACK);
         }
@@ -215,10 +362,6 @@ void drawView(GameModel &model)
                INFO_WHITE_TIME_Y},
               getTimer(model,
                            PLAYER_BLACK));
-    drawCenteredText({INFO_CENTERED_X,
-                      INFO_TITLE_Y},
-                     TITLE_FONT_SIZE,
-                     GAME_NAME);
     drawScore("White score: ",
               {INFO_CENTERED_X,
                INFO_BLACK_SCORE_Y},
@@ -229,6 +372,9 @@ void drawView(GameModel &model)
               getTimer(model,
                            PLAYER_WHITE));
 
+    if (stats)
+        drawSearchStats(*stats);
+
     if (model.gameOver)
     {
         drawButton({INFO_PLAYBLACK_BUTTON_X,
@@ -242,6 +388,101 @@ void drawView(GameModel &model)
                    WHITE);
     }
 
+    EndTextureMode();
+}
+
+/**
+ * @brief Returns what the frame layer shows.
+ *
+ * @param model The game model.
+ * @param stats The search statistics, or nullptr.
+ * @return The frame state.
+ */
+static FrameState getFrameState(GameModel &model, const SearchStats *stats)
+{
+    FrameState state = FrameState();
+
+    state.board[PLAYER_BLACK] = model.board[PLAYER_BLACK];
+    state.board[PLAYER_WHITE] = model.board[PLAYER_WHITE];
+    state.gameOver = model.gameOver;
+    state.blackSeconds = (int)getTimer(model, PLAYER_BLACK);
+    state.whiteSeconds = (int)getTimer(model, PLAYER_WHITE);
+
+    state.showStats = (stats != nullptr);
+    if (stats)
+    {
+        state.statsNodes = stats->nodes;
+        state.statsDepth = stats->depth;
+        state.statsScore = stats->score;
+        state.statsSeconds = stats->seconds;
+    }
+
+    return state;
+}
+
+static bool isFrameStateEqual(const FrameState &a, const FrameState &b)
+{
+    return (a.board[PLAYER_BLACK] == b.board[PLAYER_BLACK]) &&
+           (a.board[PLAYER_WHITE] == b.board[PLAYER_WHITE]) &&
+           (a.gameOver == b.gameOver) &&
+           (a.blackSeconds == b.blackSeconds) &&
+           (a.whiteSeconds == b.whiteSeconds) &&
+           (a.showStats == b.showStats) &&
+           (a.statsNodes == b.statsNodes) &&
+           (a.statsDepth == b.statsDepth) &&
+           (a.statsScore == b.statsScore) &&
+           (a.statsSeconds == b.statsSeconds);
+}
+
+/**
+ * @brief Lowers the frame rate while nothing changes and there is no input,
+ * and restores it on the first change or input.
+ *
+ * @param changed Whether the frame changed.
+ */
+static void updateFrameRate(bool changed)
+{
+    Vector2 mouseDelta = GetMouseDelta();
+    bool activity = changed ||
+                    (mouseDelta.x != 0) || (mouseDelta.y != 0) ||
+                    (GetMouseWheelMove() != 0) ||
+                    (GetKeyPressed() != 0) ||
+                    IsWindowResized();
+    double now = GetTime();
+
+    if (activity)
+    {
+        lastActivityTime = now;
+        if (idle)
+        {
+            SetTargetFPS(ACTIVE_FPS);
+            idle = false;
+        }
+    }
+    else if (!idle && ((now - lastActivityTime) > IDLE_DELAY))
+    {
+        SetTargetFPS(IDLE_FPS);
+        idle = true;
+    }
+}
+
+void drawView(GameModel &model, const SearchStats *stats)
+{
+    FrameState state = getFrameState(model, stats);
+    bool changed = !frameValid || !isFrameStateEqual(state, frameState);
+
+    if (changed)
+    {
+        renderFrameLayer(model, stats);
+        frameState = state;
+        frameValid = true;
+    }
+
+    updateFrameRate(changed);
+
+    // Cada cuadro es una sola textura
+    BeginDrawing();
+    drawLayer(frameLayer);
     EndDrawing();
 }
 
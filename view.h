@@ -10,6 +10,8 @@
 
 #include "model.h"
 
+struct SearchStats;
+
 /**
  * @brief Initializes a game view.
  */
@@ -24,8 +26,10 @@ void freeView();
  * @brief Draws the game view.
  *
  * @param model The game model.
+ * @param stats The statistics of the AI's last search, shown under the
+ * title, or nullptr to hide them.
  */
-void drawView(GameModel &model);
+void drawView(GameModel &model, const SearchStats *stats);
 
 /**
  * @brief Returns the square over the mouse pointer.